@@ -1,18 +1,142 @@
 #include "pch.h"
 #include "Checkers.h"
+#include "../Trainer/Public/ZobristKeys.h"
 #include <iostream>
 #include <algorithm>
+#include <cassert>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
-Checkers::Checkers() 
+namespace
 {
-    Reset();
+    // Directions as (row, column) steps, in the order the moves are generated.
+    constexpr int DirectionRows[4] = { 1, 1, -1, -1 };
+    constexpr int DirectionCols[4] = { 1, -1, 1, -1 };
+    const int KingDirections[4] = { 0, 1, 2, 3 };
+    // Men look forward first, then backward for captures.
+    const int FirstPlayerManDirections[4] = { 2, 3, 0, 1 };
+    const int SecondPlayerManDirections[4] = { 0, 1, 2, 3 };
+
+    /// <summary>Diagonal neighbours, jump targets and rays for the 32 dark squares, index row * 4 + col / 2.</summary>
+    struct SquareTables
+    {
+        int Square64[32] = {};
+        int Neighbor[32][4] = {};
+        int Jump[32][4] = {};
+        /// <summary>Every square from the square to the edge in one direction, excluding the square itself.</summary>
+        uint32_t Ray[32][4] = {};
+
+        constexpr SquareTables()
+        {
+            for (int square = 0; square < 32; ++square)
+            {
+                int row = square / 4;
+                int col = (square % 4) * 2 + (row + 1) % 2;
+                Square64[square] = row * 8 + col;
+                for (int d = 0; d < 4; ++d)
+                {
+                    Neighbor[square][d] = -1;
+                    Jump[square][d] = -1;
+                    Ray[square][d] = 0;
+                    for (int step = 1;; ++step)
+                    {
+                        int r = row + step * DirectionRows[d], c = col + step * DirectionCols[d];
+                        if (r < 0 || r >= 8 || c < 0 || c >= 8)
+                        {
+                            break;
+                        }
+                        int target = (r * 8 + c) / 2;
+                        if (step == 1)
+                        {
+                            Neighbor[square][d] = target;
+                        }
+                        else if (step == 2)
+                        {
+                            Jump[square][d] = target;
+                        }
+                        Ray[square][d] |= 1u << target;
+                    }
+                }
+            }
+        }
+    };
+
+    // Built at compile time, so games created during static initialization already see them.
+    constexpr SquareTables Tables;
+
+    inline int LowestBit(uint32_t mask)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+
+    inline int HighestBit(uint32_t mask)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse(&index, mask);
+        return static_cast<int>(index);
+#else
+        return 31 - __builtin_clz(mask);
+#endif
+    }
+
+    /// <summary>The occupied square closest to the start of a ray. Square indices grow with the row.</summary>
+    inline int NearestOnRay(uint32_t mask, int direction)
+    {
+        return DirectionRows[direction] > 0 ? LowestBit(mask) : HighestBit(mask);
+    }
+
+    /// <summary>Appends one move per square of the mask, nearest to the origin first.</summary>
+    inline int AddRayMoves(int from, uint32_t targets, int direction, int* moves, int count)
+    {
+        while (targets)
+        {
+            int to = NearestOnRay(targets, direction);
+            targets &= ~(1u << to);
+            moves[count++] = Tables.Square64[from] * 100 + Tables.Square64[to];
+        }
+        return count;
+    }
+
+    /// <summary>The part of a ray that lies before the blocker, or the whole ray when nothing blocks it.</summary>
+    inline uint32_t RayUntilBlocker(int square, int direction, uint32_t occupied)
+    {
+        uint32_t ray = Tables.Ray[square][direction];
+        uint32_t blockers = ray & occupied;
+        if (!blockers)
+        {
+            return ray;
+        }
+        int blocker = NearestOnRay(blockers, direction);
+        return ray & ~(Tables.Ray[blocker][direction] | (1u << blocker));
+    }
+
+    /// <summary>Zobrist keys for every dark square: rows 0 to 3 for men and kings of both players (player * 2 + 1 for kings),
+    /// row 4 for the square of a capture that has to be continued.</summary>
+    constexpr ZobristTable<5, 32> Zobrist(0xC4EC4E85ull);
+    const int MultiCaptureKeys = 4;
+
+    inline uint64_t PieceKey(int player, bool king, int square)
+    {
+        return Zobrist.Keys[player * 2 + (king ? 1 : 0)][square];
+    }
+
+    inline uint64_t MultiCaptureKey(int square)
+    {
+        return square >= 0 ? Zobrist.Keys[MultiCaptureKeys][square] : 0;
+    }
 }
 
-Checkers::Checkers(const Checkers& other) 
+Checkers::Checkers() 
 {
-    m_board = other.m_board;
-    m_currentPlayer = other.m_currentPlayer;
-    m_winner = other.m_winner;
+    Reset();
 }
 
 std::unordered_map<int, std::string> Checkers::GetSpritePaths() const
@@ -35,7 +159,7 @@ std::vector<std::vector<int>> Checkers::GetSpriteGrid() const
     {
         for (int y = 0; y < m_cols; ++y)
         {
-            int piece = m_board[x][y];
+            int piece = GetPiece(x, y);
 
             switch (piece)
             {
@@ -68,25 +192,35 @@ Checkers::~Checkers()
 
 void Checkers::Reset() 
 {
-    m_board = std::vector<std::vector<int>>(8, std::vector<int>(8, 0));
+    m_pieces[0] = 0xFFF00000u; // rows 5 to 7
+    m_pieces[1] = 0x00000FFFu; // rows 0 to 2
+    m_kings = 0;
     m_currentPlayer = 1;
     m_winner = Winner::OnGoing;
-    m_moveHistory.clear();
+    m_multiCaptureSquare = -1;
+    m_historyEnd = 0;
+    m_historyCount = 0;
+    m_hash = ComputeHash();
+}
 
-    for (int r = 0; r < 3; ++r) 
+int Checkers::GetPiece(int row, int col) const
+{
+    if ((row + col) % 2 == 0)
     {
-        for (int c = (r + 1) % 2; c < 8; c += 2) 
-        {
-            m_board[r][c] = 2;
-        }
+        return 0;
     }
-    for (int r = 5; r < 8; ++r) 
+
+    uint32_t bit = 1u << ((row * 8 + col) / 2);
+    int king = (m_kings & bit) ? 2 : 0;
+    if (m_pieces[0] & bit)
     {
-        for (int c = (r + 1) % 2; c < 8; c += 2) 
-        {
-            m_board[r][c] = 1;
-        }
+        return 1 + king;
+    }
+    if (m_pieces[1] & bit)
+    {
+        return 2 + king;
     }
+    return 0;
 }
 
 bool Checkers::MakeMove(int x, int y)
@@ -96,7 +230,7 @@ bool Checkers::MakeMove(int x, int y)
         return false;
     }
 
-    int piece = m_board[x][y];
+    int piece = GetPiece(x, y);
 
     if (!m_selectionActive)
     {
@@ -116,7 +250,8 @@ bool Checkers::MakeMove(int x, int y)
         int to = x * 8 + y;
         int moveCode = from * 100 + to;
 
-        std::vector<int> validMoves = GetValidMoves();
+        MoveList validMoves;
+        GenerateMoves(validMoves);
         for (int code : validMoves)
         {
             if (code == moveCode)
@@ -172,449 +307,245 @@ bool Checkers::MakeMove(int moveCode)
         return false;
     }
 
-    int from = moveCode / 100, to = moveCode % 100;
-    int fr = from / 8, fc = from % 8;
-    int tr = to / 8, tc = to % 8;
-
-    if (fr < 0 || fr >= 8 || fc < 0 || fc >= 8 || tr < 0 || tr >= 8 || tc < 0 || tc >= 8)
+    int moves[m_maxMoves];
+    int moveCount = GenerateMoves(moves);
+    if (std::find(moves, moves + moveCount, moveCode) == moves + moveCount)
     {
         return false;
     }
 
-    if (m_multiCaptureRow != -1 && (fr != m_multiCaptureRow || fc != m_multiCaptureCol))
-    {
-        return false;
-    }
+    int from64 = moveCode / 100, to64 = moveCode % 100;
+    int from = from64 / 2, to = to64 / 2;
+    int player = m_currentPlayer - 1;
+    uint32_t fromBit = 1u << from, toBit = 1u << to;
+    bool isKing = (m_kings & fromBit) != 0;
 
-    int piece = m_board[fr][fc];
-    bool isKing = (piece == 3 || piece == 4);
-    if ((m_currentPlayer == 1 && (piece != 1 && piece != 3)) ||
-        (m_currentPlayer == 2 && (piece != 2 && piece != 4)))
-    {
-        return false;
-    }
+    // Whatever enemy piece lies between the two squares is captured; validation guarantees at most one.
+    int direction = (to64 / 8 > from64 / 8 ? 0 : 2) + (to64 % 8 > from64 % 8 ? 0 : 1);
+    uint32_t between = Tables.Ray[from][direction] & ~(Tables.Ray[to][direction] | toBit);
+    uint32_t captured = between & m_pieces[1 - player];
 
-    int dr = tr - fr, dc = tc - fc;
-    if (std::abs(dr) != std::abs(dc))
+    MoveRecord& rec = m_moveHistory[m_historyEnd];
+    m_historyEnd = (m_historyEnd + 1) % m_historyCapacity;
+    if (m_historyCount < m_historyCapacity)
     {
-        return false;
+        m_historyCount++;
     }
-
-    bool isCapture = false;
-    int capR = -1, capC = -1, capPiece = 0;
-
+    rec.from = static_cast<int8_t>(from);
+    rec.to = static_cast<int8_t>(to);
+    rec.captured = static_cast<int8_t>(captured ? LowestBit(captured) : -1);
+    rec.capturedKing = (m_kings & captured) != 0;
+    rec.multiCaptureSquare = static_cast<int8_t>(m_multiCaptureSquare);
+    rec.promoted = false;
+
+    m_pieces[player] = (m_pieces[player] & ~fromBit) | toBit;
     if (isKing)
     {
-        int steps = std::abs(dr);
-        int drStep = dr / steps, dcStep = dc / steps;
-
-        int enemyCount = 0;
-        for (int s = 1; s < steps; ++s)
-        {
-            int r = fr + s * drStep, c = fc + s * dcStep;
-            if (m_board[r][c] != 0)
-            {
-                if ((m_board[r][c] % 2) == (piece % 2))
-                {
-                    return false;
-                }
-                if (++enemyCount > 1)
-                {
-                    return false;
-                }
-                capR = r; capC = c; capPiece = m_board[r][c];
-            }
-        }
-
-        if (m_board[tr][tc] != 0)
-        {
-            return false;
-        }
-
-        if (enemyCount == 1)
-        {
-            isCapture = true;
-        }
-        else if (enemyCount == 0)
-        {
-            if (m_multiCaptureRow != -1)
-            {
-                return false;
-            }
-        }
-        else
-        {
-            return false;
-        }
+        m_kings = (m_kings & ~fromBit) | toBit;
     }
-    else
+    if (captured)
     {
-        if (std::abs(dr) == 1)
-        {
-            if (m_multiCaptureRow != -1) return false;
-            if (m_board[tr][tc] != 0)       return false;
-            if ((m_currentPlayer == 1 && dr != -1) ||
-                (m_currentPlayer == 2 && dr != 1))
-            {
-                return false;
-            }
-        }
-        else if (std::abs(dr) == 2)
-        {
-            int mr = (fr + tr) / 2, mc = (fc + tc) / 2;
-            int mid = m_board[mr][mc];
-            if (mid == 0 || (mid % 2) == (piece % 2) || m_board[tr][tc] != 0)
-            {
-                return false;
-            }
-            isCapture = true;
-            capR = mr; capC = mc; capPiece = mid;
-        }
-        else
-        {
-            return false;
-        }
+        m_pieces[1 - player] &= ~captured;
+        m_kings &= ~captured;
     }
 
-    if (m_multiCaptureRow == -1)
+    if (!isKing && ((m_currentPlayer == 1 && to / 4 == 0) || (m_currentPlayer == 2 && to / 4 == 7)))
     {
-        auto allMoves = GetValidMoves();
-        bool existsCapture = std::any_of(allMoves.begin(), allMoves.end(), [&](int mv) {
-            return IsMoveCapture(mv);
-        });
-        if (existsCapture && !isCapture)
-        {
-            return false;
-        }
+        m_kings |= toBit;
+        rec.promoted = true;
     }
 
-    MoveRecord rec{ moveCode, capR, capC, capPiece,
-                    m_multiCaptureRow, m_multiCaptureCol,
-                    m_board, m_currentPlayer, m_winner };
-    m_moveHistory.push_back(rec);
-
-    m_board[fr][fc] = 0;
-    m_board[tr][tc] = piece;
-    if (isCapture)
+    bool more = false;
+    if (captured)
     {
-        m_board[capR][capC] = 0;
+        more = AddCaptures(to, KingDirections, moves, 0) > 0;
     }
 
-    if ((m_currentPlayer == 1 && tr == 0 && piece == 1) ||
-        (m_currentPlayer == 2 && tr == 7 && piece == 2))
+    m_hash ^= PieceKey(player, isKing, from) ^ PieceKey(player, isKing || rec.promoted, to);
+    if (captured)
     {
-        m_board[tr][tc] += 2;
-    }
-
-    bool more = false;
-    if (isCapture)
-    {
-        int saveRow = m_multiCaptureRow, saveCol = m_multiCaptureCol;
-        m_multiCaptureRow = tr; m_multiCaptureCol = tc;
-        auto next = GetValidMoves();
-        m_multiCaptureRow = saveRow; m_multiCaptureCol = saveCol;
-        more = !next.empty();
+        m_hash ^= PieceKey(1 - player, rec.capturedKing, rec.captured);
     }
+    m_hash ^= MultiCaptureKey(m_multiCaptureSquare) ^ MultiCaptureKey(more ? to : -1);
 
     if (more)
     {
-        m_multiCaptureRow = tr;
-        m_multiCaptureCol = tc;
+        m_multiCaptureSquare = to;
     }
     else
     {
-        m_multiCaptureRow = m_multiCaptureCol = -1;
+        m_multiCaptureSquare = -1;
         m_currentPlayer = 3 - m_currentPlayer;
+        m_hash ^= Zobrist.SecondPlayerToMove;
 
-        bool oppHasPiece = false;
-        for (auto& row : m_board)
-        {
-            for (int p : row)
-            {
-                if (p != 0 && ((p % 2) == (m_currentPlayer % 2)))
-                {
-                    oppHasPiece = true;
-                }
-            }
-        }
-
-        bool oppHasMoves = !GetValidMoves().empty();
+        bool oppHasPiece = m_pieces[m_currentPlayer - 1] != 0;
+        bool oppHasMoves = GenerateMoves(moves) > 0;
 
         if (!oppHasPiece || !oppHasMoves)
         {
-            m_winner = (m_currentPlayer == 1 ? Winner::FirstPlayer : Winner::SecondPlayer);
+            m_winner = (m_currentPlayer == 1 ? Winner::SecondPlayer : Winner::FirstPlayer);
         }
     }
 
     return true;
 }
 
-bool Checkers::IsMoveCapture(int move) 
+bool Checkers::UnMakeMove() 
 {
-    int from = move / 100;
-    int to = move % 100;
-    int fr = from / 8, fc = from % 8;
-    int tr = to / 8, tc = to % 8;
-    int dr = (tr - fr) > 0 ? 1 : -1;
-    int dc = (tc - fc) > 0 ? 1 : -1;
-    int r = fr + dr, c = fc + dc;
-    while (r != tr && c != tc)
+    if (m_historyCount == 0)
     {
-        if (m_board[r][c] != 0 && (m_board[r][c] % 2) != (m_board[fr][fc] % 2))
-        {
-            return true;
-        }
-        else if (m_board[r][c] != 0)
-        {
-            break;
-        }
-        r += dr;
-        c += dc;
+        return false;
     }
-    return false;
-}
 
+    m_historyEnd = (m_historyEnd + m_historyCapacity - 1) % m_historyCapacity;
+    m_historyCount--;
+    const MoveRecord& lastMove = m_moveHistory[m_historyEnd];
 
-bool Checkers::UnMakeMove() 
-{
-    if (m_moveHistory.empty())
+    if (m_multiCaptureSquare == -1)
     {
-        return false;
+        m_currentPlayer = 3 - m_currentPlayer;
+        m_hash ^= Zobrist.SecondPlayerToMove;
     }
+    m_winner = Winner::OnGoing;
 
-    MoveRecord lastMove = m_moveHistory.back();
-    m_moveHistory.pop_back();
-
-    m_board = lastMove.boardState;
-    m_currentPlayer = lastMove.savedPlayer;
-    m_winner = lastMove.savedWinner;
-    m_multiCaptureRow = lastMove.multiCaptureRow;
-    m_multiCaptureCol = lastMove.multiCaptureCol;
+    int player = m_currentPlayer - 1;
+    uint32_t fromBit = 1u << lastMove.from, toBit = 1u << lastMove.to;
+    bool wasKing = (m_kings & toBit) && !lastMove.promoted;
+    m_hash ^= PieceKey(player, wasKing, lastMove.from) ^ PieceKey(player, (m_kings & toBit) != 0, lastMove.to);
+    m_pieces[player] = (m_pieces[player] & ~toBit) | fromBit;
+    if (wasKing)
+    {
+        m_kings |= fromBit;
+    }
+    m_kings &= ~toBit;
+    if (lastMove.captured >= 0)
+    {
+        uint32_t capturedBit = 1u << lastMove.captured;
+        m_pieces[1 - player] |= capturedBit;
+        if (lastMove.capturedKing)
+        {
+            m_kings |= capturedBit;
+        }
+        m_hash ^= PieceKey(1 - player, lastMove.capturedKing, lastMove.captured);
+    }
+    m_hash ^= MultiCaptureKey(m_multiCaptureSquare) ^ MultiCaptureKey(lastMove.multiCaptureSquare);
+    m_multiCaptureSquare = lastMove.multiCaptureSquare;
 
     return true;
 }
 
-std::vector<int> Checkers::GetValidMoves() const
+int Checkers::GenerateMoves(MoveList& moves) const
+{
+    static_assert(m_maxMoves <= MoveList::Capacity, "move list too small for checkers");
+    moves.Count = GenerateMoves(moves.Moves);
+    return moves.Count;
+}
+
+int Checkers::AddCaptures(int square, const int* directions, int* moves, int count) const
 {
-    std::vector<int> moves, caps;
-    int forwardDir = (m_currentPlayer == 1 ? -1 : 1);
+    uint32_t bit = 1u << square;
+    int player = (m_pieces[0] & bit) ? 0 : 1;
+    uint32_t enemy = m_pieces[1 - player];
+    uint32_t occupied = m_pieces[0] | m_pieces[1];
 
-    auto trySlide = [&](int fr, int fc, int dr, int dc) 
+    for (int i = 0; i < 4; ++i)
     {
-        for (int s = 1;; ++s) 
+        int d = directions[i];
+        if (!(m_kings & bit))
         {
-            int tr = fr + s * dr, tc = fc + s * dc;
-            if (tr < 0 || tr >= 8 || tc < 0 || tc >= 8)
+            int over = Tables.Neighbor[square][d], to = Tables.Jump[square][d];
+            if (to >= 0 && (enemy & (1u << over)) && !(occupied & (1u << to)))
             {
-                break;
+                moves[count++] = Tables.Square64[square] * 100 + Tables.Square64[to];
             }
-            if (m_board[tr][tc] != 0)
-            {
-                break;
-            }
-            moves.push_back((fr * 8 + fc) * 100 + (tr * 8 + tc));
         }
-    };
-
-    if (m_multiCaptureRow != -1)
-    {
-        int fr = m_multiCaptureRow, fc = m_multiCaptureCol;
-        int piece = m_board[fr][fc];
-        bool king = (piece == 3 || piece == 4);
-        std::vector<std::pair<int, int>> dirs = { {1,1}, {1,-1}, {-1,1}, {-1,-1} };
-
-        for (const auto& dir : dirs)
+        else
         {
-            int dr = dir.first, dc = dir.second;
-            if (!king)
+            uint32_t blockers = Tables.Ray[square][d] & occupied;
+            if (!blockers)
             {
-                int mr = fr + dr, mc = fc + dc;
-                int tr = fr + 2 * dr, tc = fc + 2 * dc;
-                if (tr < 0 || tr >= 8 || tc < 0 || tc >= 8)
-                {
-                    continue;
-                }
-                int mid = m_board[mr][mc];
-                if (m_board[tr][tc] == 0 && mid != 0 && (mid % 2) != (piece % 2))
-                {
-                    caps.push_back((fr * 8 + fc) * 100 + (tr * 8 + tc));
-                }
+                continue;
             }
-            else
+            int blocker = NearestOnRay(blockers, d);
+            if (!(enemy & (1u << blocker)))
             {
-                for (int s = 1;; ++s)
-                {
-                    int r = fr + s * dr, c = fc + s * dc;
-                    if (r < 0 || r >= 8 || c < 0 || c >= 8)
-                    {
-                        break;
-                    }
-                    if (m_board[r][c] == 0)
-                    {
-                        continue;
-                    }
-                    if ((m_board[r][c] % 2) == (piece % 2))
-                    {
-                        break;
-                    }
-
-                    for (int t = 1;; ++t)
-                    {
-                        int tr = r + t * dr, tc = c + t * dc;
-                        if (tr < 0 || tr >= 8 || tc < 0 || tc >= 8)
-                        {
-                            break;
-                        }
-                        if (m_board[tr][tc] != 0)
-                        {
-                            break;
-                        }
-                        caps.push_back((fr * 8 + fc) * 100 + (tr * 8 + tc));
-                    }
-                    break;
-                }
+                continue;
             }
+            count = AddRayMoves(square, RayUntilBlocker(blocker, d, occupied), d, moves, count);
         }
-        return caps;
     }
+    return count;
+}
 
-    for (int r = 0; r < 8; ++r) for (int c = 0; c < 8; ++c)
+int Checkers::GenerateMoves(int* moves) const
+{
+    if (m_multiCaptureSquare != -1)
     {
-        int piece = m_board[r][c];
-        if (piece == 0 || ((piece % 2) != (m_currentPlayer % 2)))
-        {
-            continue;
-        }
-
-        bool king = (piece == 3 || piece == 4);
-        std::vector<std::pair<int, int>> dirs = king ?
-            std::vector<std::pair<int, int>>{{1, 1}, { 1,-1 }, { -1,1 }, { -1,-1 }} :
-            std::vector<std::pair<int, int>>{ {forwardDir,1},{forwardDir,-1},{-forwardDir,1},{-forwardDir,-1} };
+        return AddCaptures(m_multiCaptureSquare, KingDirections, moves, 0);
+    }
 
-        for (const auto& dir : dirs)
-        {
-            int dr = dir.first, dc = dir.second;
-            if (!king)
-            {
-                int mr = r + dr, mc = c + dc, tr = r + 2 * dr, tc = c + 2 * dc;
-                if (tr < 0 || tr >= 8 || tc < 0 || tc >= 8)
-                {
-                    continue;
-                }
-                int mid = m_board[mr][mc];
-                if (m_board[tr][tc] == 0 && mid != 0 && (mid % 2) != (piece % 2))
-                {
-                    caps.push_back((r * 8 + c) * 100 + (tr * 8 + tc));
-                }
-            }
-            else
-            {
-                for (int s = 1;; ++s)
-                {
-                    int cr = r + s * dr, cc = c + s * dc;
-                    if (cr < 0 || cr >= 8 || cc < 0 || cc >= 8)
-                    {
-                        break;
-                    }
-                    if (m_board[cr][cc] == 0)
-                    {
-                        continue;
-                    }
-                    if ((m_board[cr][cc] % 2) == (piece % 2))
-                    {
-                        break;
-                    }
+    uint32_t own = m_pieces[m_currentPlayer - 1];
+    uint32_t occupied = m_pieces[0] | m_pieces[1];
+    const int* manDirections = m_currentPlayer == 1 ? FirstPlayerManDirections : SecondPlayerManDirections;
+    int count = 0;
 
-                    for (int t = 1;; ++t)
-                    {
-                        int tr = cr + t * dr, tc = cc + t * dc;
-                        if (tr < 0 || tr >= 8 || tc < 0 || tc >= 8)
-                        {
-                            break;
-                        }
-                        if (m_board[tr][tc] != 0)
-                        {
-                            break;
-                        }
-                        caps.push_back((r * 8 + c) * 100 + (tr * 8 + tc));
-                    }
-                    break;
-                }
-            }
-        }
+    for (uint32_t rest = own; rest; rest &= rest - 1)
+    {
+        int square = LowestBit(rest);
+        count = AddCaptures(square, (m_kings & (1u << square)) ? KingDirections : manDirections, moves, count);
     }
 
-    if (!caps.empty())
+    if (count > 0)
     {
-        return caps;
+        return count;
     }
 
-    for (int r = 0; r < 8; ++r) for (int c = 0; c < 8; ++c)
+    for (uint32_t rest = own; rest; rest &= rest - 1)
     {
-        int piece = m_board[r][c];
-        if (piece == 0 || ((piece % 2) != (m_currentPlayer % 2)))
-        {
-            continue;
-        }
-
-        bool king = (piece == 3 || piece == 4);
-        if (!king)
+        int square = LowestBit(rest);
+        if (!(m_kings & (1u << square)))
         {
-            int tr = r + forwardDir, tc = c + 1;
-            if (tr >= 0 && tr < 8 && tc >= 0 && tc < 8 && m_board[tr][tc] == 0)
+            // The first two man directions are the forward ones.
+            for (int i = 0; i < 2; ++i)
             {
-                moves.push_back((r * 8 + c) * 100 + (tr * 8 + tc));
-            }
-            tc = c - 1;
-            if (tr >= 0 && tr < 8 && tc >= 0 && tc < 8 && m_board[tr][tc] == 0)
-            {
-                moves.push_back((r * 8 + c) * 100 + (tr * 8 + tc));
+                int to = Tables.Neighbor[square][manDirections[i]];
+                if (to >= 0 && !(occupied & (1u << to)))
+                {
+                    moves[count++] = Tables.Square64[square] * 100 + Tables.Square64[to];
+                }
             }
         }
         else
         {
-            std::vector<std::pair<int, int>> dirs = { {1,1},{1,-1},{-1,1},{-1,-1} };
-            for (const auto& dir : dirs)
+            for (int d : KingDirections)
             {
-                trySlide(r, c, dir.first, dir.second);
+                count = AddRayMoves(square, RayUntilBlocker(square, d, occupied), d, moves, count);
             }
         }
     }
 
-    return moves;
+    return count;
 }
 
-std::vector<float> Checkers::GetBoardState() const 
+int Checkers::StateSize() const
 {
-    std::vector<float> state;
-    for (const auto& row : m_board)
+    return m_rows * m_cols + 1;
+}
+
+void Checkers::EncodeState(float* state) const 
+{
+    // All 64 squares row by row: 1 for men and 1.5 for kings, negative for player 2, then the player to move.
+    std::fill(state, state + m_rows * m_cols, 0.0f);
+    for (int player = 0; player < 2; ++player)
     {
-        for (int cell : row)
+        float sign = player == 0 ? 1.0f : -1.0f;
+        for (uint32_t pieces = m_pieces[player]; pieces; pieces &= pieces - 1)
         {
-            if (cell == 1)
-            {
-                state.push_back(1.f);
-            }
-            else if (cell == 3) 
-            {
-                state.push_back(1.5f);
-            }
-            else if (cell == 2)
-            {
-                state.push_back(-1.f);
-            }
-            else if (cell == 4)
-            {
-                state.push_back(-1.5f);
-            }
-            else
-            {
-                state.push_back(0.f);
-            }
+            int square = LowestBit(pieces);
+            state[Tables.Square64[square]] = sign * ((m_kings & (1u << square)) ? 1.5f : 1.0f);
         }
     }
-    state.push_back(static_cast<float>(m_currentPlayer));
-    return state;
+    state[m_rows * m_cols] = static_cast<float>(m_currentPlayer);
 }
 
 std::vector<float> Checkers::GetState() const 
@@ -632,6 +563,111 @@ int Checkers::GetCurrentPlayer() const
     return m_currentPlayer;
 }
 
+uint32_t Checkers::GetPieces(int player) const
+{
+    return m_pieces[player - 1];
+}
+
+uint32_t Checkers::GetKings() const
+{
+    return m_kings;
+}
+
+int Checkers::GetMultiCaptureSquare() const
+{
+    return m_multiCaptureSquare;
+}
+
+void Checkers::SetPosition(uint32_t firstPlayer, uint32_t secondPlayer, uint32_t kings, int currentPlayer)
+{
+    m_pieces[0] = firstPlayer;
+    m_pieces[1] = secondPlayer;
+    m_kings = kings & (firstPlayer | secondPlayer);
+    m_currentPlayer = currentPlayer;
+    m_multiCaptureSquare = -1;
+    m_selectionActive = false;
+    m_historyEnd = 0;
+    m_historyCount = 0;
+    m_hash = ComputeHash();
+
+    int moves[m_maxMoves];
+    bool hasMoves = m_pieces[m_currentPlayer - 1] != 0 && GenerateMoves(moves) > 0;
+    m_winner = hasMoves ? Winner::OnGoing : (m_currentPlayer == 1 ? Winner::SecondPlayer : Winner::FirstPlayer);
+}
+
+uint64_t Checkers::GetHash() const
+{
+    // Debug builds recompute the hash on every call.
+    assert(m_hash == ComputeHash());
+    return m_hash;
+}
+
+uint64_t Checkers::ComputeHash(int transform) const
+{
+    // The colour flip turns the board around and exchanges the players, pieces and side to move included.
+    bool flip = transform != 0;
+    int toMove = flip ? 3 - m_currentPlayer : m_currentPlayer;
+    uint64_t hash = toMove == 2 ? Zobrist.SecondPlayerToMove : 0;
+    for (int square = 0; square < 32; ++square)
+    {
+        uint32_t bit = 1u << square;
+        for (int player = 0; player < 2; ++player)
+        {
+            if (m_pieces[player] & bit)
+            {
+                hash ^= flip ? PieceKey(1 - player, (m_kings & bit) != 0, 31 - square) : PieceKey(player, (m_kings & bit) != 0, square);
+            }
+        }
+    }
+    int multiCaptureSquare = flip && m_multiCaptureSquare >= 0 ? 31 - m_multiCaptureSquare : m_multiCaptureSquare;
+    return hash ^ MultiCaptureKey(multiCaptureSquare);
+}
+
+// Transform 1 is the colour flip: the board turned by 180 degrees with the players exchanged.
+int Checkers::SymmetryCount() const
+{
+    return 2;
+}
+
+uint64_t Checkers::GetSymmetricHash(int transform) const
+{
+    return transform == 0 ? m_hash : ComputeHash(transform);
+}
+
+int Checkers::TransformMove(int move, int transform) const
+{
+    if (transform == 0)
+    {
+        return move;
+    }
+    int from64 = move / 100, to64 = move % 100;
+    return (63 - from64) * 100 + (63 - to64);
+}
+
+int Checkers::InverseTransform(int transform) const
+{
+    return transform;
+}
+
+bool Checkers::SwapsPlayers(int transform) const
+{
+    return transform != 0;
+}
+
+void Checkers::EncodeSymmetricState(float* state, int transform) const
+{
+    EncodeState(state);
+    if (transform != 0)
+    {
+        std::reverse(state, state + m_rows * m_cols);
+        for (int i = 0; i < m_rows * m_cols; ++i)
+        {
+            state[i] = -state[i];
+        }
+        state[m_rows * m_cols] = static_cast<float>(3 - m_currentPlayer);
+    }
+}
+
 std::string Checkers::GetName() const 
 {
     return "Checkers";
@@ -642,6 +678,11 @@ std::unique_ptr<IGame> Checkers::Clone() const
     return std::make_unique<Checkers>(*this);
 }
 
+void Checkers::CopyFrom(const IGame& other)
+{
+    *this = static_cast<const Checkers&>(other);
+}
+
 void Checkers::PrintBoard() const 
 {
     std::cout << "  a b c d e f g h\n";
@@ -651,7 +692,7 @@ void Checkers::PrintBoard() const
         for (int c = 0; c < 8; ++c) 
         {
             char ch = '.';
-            switch (m_board[r][c]) 
+            switch (GetPiece(r, c)) 
             {
             case 1: 
                 ch = 'x';
@@ -1,13 +1,20 @@
 #pragma once
 #include "IGame.h"
 #include <vector>
+#include <cstdint>
 
+#ifdef _WIN32
 #define IGAME_API __declspec(dllexport)
+#else
+#define IGAME_API __attribute__((visibility("default")))
+#endif
 
-class IGAME_API Checkers : public IGame {
+class IGAME_API Checkers final : public IGame {
 public:
     Checkers();
-    Checkers(const Checkers& other);
+    /// <summary>The state is fixed-size arrays and scalars only, so copies are flat and keep the undo history and a pending capture.</summary>
+    Checkers(const Checkers&) = default;
+    Checkers& operator=(const Checkers&) = default;
     std::unordered_map<int, std::string> GetSpritePaths() const;
     std::vector<std::vector<int>> GetSpriteGrid() const;
     bool InterpretAndMakeMove(const std::string& moveStr);
@@ -16,43 +23,74 @@ public:
     bool MakeMove(int moveIndex);
     bool UnMakeMove();
     Winner GetWinner() const;
-    std::vector<int> GetValidMoves() const;
+    int GenerateMoves(MoveList& moves) const;
     std::vector<float> GetState() const;
     int GetCurrentPlayer() const;
+    /// <summary>Dark-square bitboard of the player's pieces, men and kings, index row * 4 + col / 2.</summary>
+    uint32_t GetPieces(int player) const;
+    uint32_t GetKings() const;
+    /// <summary>Square of the piece that has to continue capturing, -1 when there is none.</summary>
+    int GetMultiCaptureSquare() const;
+    /// <summary>Sets up a position without history or pending capture. A player to move without moves has lost.</summary>
+    void SetPosition(uint32_t firstPlayer, uint32_t secondPlayer, uint32_t kings, int currentPlayer);
+    uint64_t GetHash() const;
+    int SymmetryCount() const;
+    uint64_t GetSymmetricHash(int transform) const;
+    int TransformMove(int move, int transform) const;
+    int InverseTransform(int transform) const;
+    bool SwapsPlayers(int transform) const;
+    void EncodeSymmetricState(float* state, int transform) const;
 
     void PrintBoard() const;
 
     std::unique_ptr<IGame> Clone() const;
-    std::vector<float> GetBoardState() const;
+    void CopyFrom(const IGame& other);
+    int StateSize() const;
+    void EncodeState(float* state) const;
 
     std::string GetName() const;
 
     ~Checkers();
 
 private:
+    /// <summary>What a move changed, enough to take it back. Squares are dark-square indices.
+    /// The game is always running before a move, and the player only stays the same while a capture continues.</summary>
     struct MoveRecord {
-        int moveCode;
-        int capturedR;
-        int capturedC;
-        int capturedPiece;
-        int multiCaptureRow;
-        int multiCaptureCol;
-        std::vector<std::vector<int>> boardState;
-        int savedPlayer;
-        Winner savedWinner;
+        int8_t from;
+        int8_t to;
+        int8_t captured; // -1 for a quiet move
+        int8_t multiCaptureSquare; // before the move
+        bool capturedKing;
+        bool promoted;
     };
 
+    /// <summary>Undo depth. Older records are overwritten, so at most this many moves can be taken back in a row.</summary>
+    static const int m_historyCapacity = 1024;
+
+    /// <summary>Upper bound for the moves of one position: twelve pieces with at most thirteen targets each.</summary>
+    static const int m_maxMoves = 12 * 13;
+
     bool m_selectionActive = false;
-    int m_multiCaptureRow = -1;
-    int m_multiCaptureCol = -1;
+    int m_multiCaptureSquare = -1;
     int m_selectedRow = 0;
     int m_selectedCol = 0;
     static const int m_rows = 8;
     static const int m_cols = 8;
-    std::vector<std::vector<int>> m_board;
+    uint32_t m_pieces[2]; // one bit per dark square, index row * 4 + col / 2
+    uint32_t m_kings;
     int m_currentPlayer;
     Winner m_winner;
-    std::vector<MoveRecord> m_moveHistory;
+    MoveRecord m_moveHistory[m_historyCapacity]; // ring buffer ending before m_historyEnd
+    int m_historyEnd = 0;
+    int m_historyCount = 0;
+    uint64_t m_hash;
 
-    bool IsMoveCapture(int move);
+    /// <summary>0 for empty, 1 and 2 for men, 3 and 4 for kings of player 1 and 2.</summary>
+    int GetPiece(int row, int col) const;
+    /// <summary>Writes the legal moves into the buffer, which needs room for m_maxMoves, and returns how many there are.</summary>
+    int GenerateMoves(int* moves) const;
+    /// <summary>Appends the captures of the piece on the square, trying the directions in the given order.</summary>
+    int AddCaptures(int square, const int* directions, int* moves, int count) const;
+    /// <summary>The position hash built from scratch, to check the incremental one, or of the position mapped through a symmetry.</summary>
+    uint64_t ComputeHash(int transform = 0) const;
 };
\ No newline at end of file
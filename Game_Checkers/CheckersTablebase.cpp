@@ -0,0 +1,846 @@
+#include "pch.h"
+#include "CheckersTablebase.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+    const char DatabaseMagic[8] = { 'C', 'K', 'T', 'B', '0', '0', '0', '1' };
+    /// <summary>Squares men of the side to move can't stand on, their promotion row, and those of the other side.</summary>
+    const uint32_t MoverPromotionRow = 0x0000000Fu;
+    const uint32_t OtherPromotionRow = 0xF0000000u;
+    /// <summary>Positions a generation thread takes at once.</summary>
+    const uint64_t ChunkSize = 4096;
+
+    /// <summary>Binomial coefficients for ranking sets of squares.</summary>
+    struct BinomialTable
+    {
+        uint64_t Value[33][33] = {};
+
+        constexpr BinomialTable()
+        {
+            for (int n = 0; n <= 32; ++n)
+            {
+                Value[n][0] = 1;
+                for (int k = 1; k <= n; ++k)
+                {
+                    Value[n][k] = Value[n - 1][k - 1] + (k < n ? Value[n - 1][k] : 0);
+                }
+            }
+        }
+    };
+    constexpr BinomialTable Binomial;
+
+    uint64_t Choose(int n, int k)
+    {
+        return (k < 0 || n < 0 || k > n) ? 0 : Binomial.Value[n][k];
+    }
+
+    int PopCount(uint32_t bits)
+    {
+        bits = bits - ((bits >> 1) & 0x55555555u);
+        bits = (bits & 0x33333333u) + ((bits >> 2) & 0x33333333u);
+        return static_cast<int>((((bits + (bits >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+    }
+
+    /// <summary>Square s becomes 31 - s: the board turned around, which is the board seen from the other side.</summary>
+    uint32_t Flip(uint32_t bits)
+    {
+        bits = ((bits >> 1) & 0x55555555u) | ((bits & 0x55555555u) << 1);
+        bits = ((bits >> 2) & 0x33333333u) | ((bits & 0x33333333u) << 2);
+        bits = ((bits >> 4) & 0x0F0F0F0Fu) | ((bits & 0x0F0F0F0Fu) << 4);
+        bits = ((bits >> 8) & 0x00FF00FFu) | ((bits & 0x00FF00FFu) << 8);
+        return (bits >> 16) | (bits << 16);
+    }
+
+    /// <summary>Colex rank of a set of squares among the squares not excluded.</summary>
+    uint64_t RankSquares(uint32_t squares, uint32_t excluded)
+    {
+        uint64_t rank = 0;
+        int count = 0;
+        for (int square = 0; square < 32; ++square)
+        {
+            if (squares & (1u << square))
+            {
+                int position = square - PopCount(excluded & ((1u << square) - 1));
+                rank += Choose(position, ++count);
+            }
+        }
+        return rank;
+    }
+
+    uint32_t UnrankSquares(uint64_t rank, int count, uint32_t excluded)
+    {
+        int positions[32];
+        int position = 31;
+        for (int i = count; i > 0; --i)
+        {
+            while (Choose(position, i) > rank)
+            {
+                --position;
+            }
+            rank -= Choose(position, i);
+            positions[i - 1] = position--;
+        }
+
+        uint32_t squares = 0;
+        int next = 0;
+        int free = 0;
+        for (int square = 0; square < 32 && next < count; ++square)
+        {
+            if (excluded & (1u << square))
+            {
+                continue;
+            }
+            if (free++ == positions[next])
+            {
+                squares |= 1u << square;
+                next++;
+            }
+        }
+        return squares;
+    }
+
+    /// <summary>Diagonal neighbours of the dark squares, in the directions (1, 1), (1, -1), (-1, 1) and (-1, -1) as (row, column).</summary>
+    struct SquareGeometry
+    {
+        int Neighbor[32][4] = {};
+
+        constexpr SquareGeometry()
+        {
+            const int rows[4] = { 1, 1, -1, -1 };
+            const int cols[4] = { 1, -1, 1, -1 };
+            for (int square = 0; square < 32; ++square)
+            {
+                int row = square / 4;
+                int col = (square % 4) * 2 + (row + 1) % 2;
+                for (int d = 0; d < 4; ++d)
+                {
+                    int toRow = row + rows[d];
+                    int toCol = col + cols[d];
+                    Neighbor[square][d] = (toRow >= 0 && toRow < 8 && toCol >= 0 && toCol < 8) ? toRow * 4 + toCol / 2 : -1;
+                }
+            }
+        }
+    };
+    constexpr SquareGeometry Geometry;
+
+    /// <summary>
+    /// Calls visit with every position from which the other side could have reached this one with a quiet move, seen from
+    /// that side as the side to move. Men of the other side move towards row 7. Whether the move was legal there is not
+    /// checked, so this finds a superset of the parents that stay in the same slices.
+    /// </summary>
+    template <typename Visit>
+    void ForEachQuietParent(uint32_t mover, uint32_t other, uint32_t kings, Visit visit)
+    {
+        uint32_t occupied = mover | other;
+        for (int square = 0; square < 32; ++square)
+        {
+            uint32_t bit = 1u << square;
+            if (!(other & bit))
+            {
+                continue;
+            }
+            bool king = (kings & bit) != 0;
+            for (int d = king ? 0 : 2; d < 4; ++d)
+            {
+                for (int from = Geometry.Neighbor[square][d]; from >= 0 && !(occupied & (1u << from)); from = king ? Geometry.Neighbor[from][d] : -1)
+                {
+                    uint32_t fromBit = 1u << from;
+                    visit(Flip((other & ~bit) | fromBit), Flip(mover), Flip(king ? (kings & ~bit) | fromBit : kings));
+                }
+            }
+        }
+    }
+
+    /// <summary>How much the player to move likes a move reaching a position with the value for the opponent:
+    /// wins soonest first, then draws, then losses latest.</summary>
+    int MoverScore(int childCode)
+    {
+        if (childCode == 0)
+        {
+            return 0;
+        }
+        int moves = childCode - 1;
+        return moves % 2 == 0 ? 1000 - moves : -1000 + moves;
+    }
+}
+
+CheckersTablebase::CheckersTablebase()
+    : m_sliceIds(13 * 13 * 13 * 13, -1)
+{
+}
+
+bool CheckersTablebase::Probe(const IGame& state, float& value) const
+{
+    if (state.GetWinner() != IGame::Winner::OnGoing)
+    {
+        value = state.GetWinner() == IGame::Winner::FirstPlayer ? 1.0f : (state.GetWinner() == IGame::Winner::SecondPlayer ? -1.0f : 0.0f);
+        return true;
+    }
+
+    int code;
+    if (!ProbeDistance(static_cast<const Checkers&>(state), code))
+    {
+        return false;
+    }
+
+    float result = code == 0 ? 0.0f : ((code - 1) % 2 == 1 ? 1.0f : -1.0f);
+    value = state.GetCurrentPlayer() == 1 ? result : -result;
+    return true;
+}
+
+int CheckersTablebase::BestMove(const IGame& state) const
+{
+    int code;
+    if (state.GetWinner() != IGame::Winner::OnGoing || !ProbeDistance(static_cast<const Checkers&>(state), code))
+    {
+        return -1;
+    }
+
+    Checkers game(static_cast<const Checkers&>(state));
+    int player = game.GetCurrentPlayer();
+    MoveList moves;
+    game.GenerateMoves(moves);
+    int bestMove = -1;
+    int bestScore = 0;
+    for (int move : moves)
+    {
+        game.MakeMove(move);
+        int score = 0;
+        bool known = true;
+        if (game.GetWinner() != IGame::Winner::OnGoing)
+        {
+            score = MoverScore(1);
+        }
+        else if (game.GetCurrentPlayer() == player)
+        {
+            // The capture continues; the rest of it is one move with this one.
+            int own = 0;
+            known = ProbeDistance(game, own);
+            score = own == 0 ? 0 : MoverScore(own - 1);
+        }
+        else
+        {
+            int childCode = 0;
+            known = Lookup(FromGame(game), childCode);
+            score = MoverScore(childCode);
+        }
+        game.UnMakeMove();
+
+        // Children missing from the tables are left out rather than guessed.
+        if (known && (bestMove < 0 || score > bestScore))
+        {
+            bestMove = move;
+            bestScore = score;
+        }
+    }
+    return bestMove;
+}
+
+void CheckersTablebase::SetProbeLimit(int limit)
+{
+    m_probeLimit = limit;
+}
+
+int CheckersTablebase::GetProbeLimit() const
+{
+    return m_probeLimit;
+}
+
+int CheckersTablebase::GetMaxPieces() const
+{
+    return m_maxPieces;
+}
+
+bool CheckersTablebase::ProbeDistance(const Checkers& game, int& code) const
+{
+    int pieces = PopCount(game.GetPieces(1) | game.GetPieces(2));
+    if (pieces > m_probeLimit || pieces > m_maxPieces)
+    {
+        return false;
+    }
+    if (game.GetWinner() != IGame::Winner::OnGoing)
+    {
+        code = 1;
+        return true;
+    }
+    if (game.GetMultiCaptureSquare() < 0)
+    {
+        return Lookup(FromGame(game), code);
+    }
+
+    // Halfway through a capture the tables don't apply, so the best way to finish it decides.
+    Checkers copy(game);
+    int bestScore = 0;
+    int bestCode = -1;
+    bool found = ForEachChild(copy, [&](int childCode, int)
+    {
+        int score = MoverScore(childCode);
+        if (bestCode < 0 || score > bestScore)
+        {
+            bestScore = score;
+            bestCode = childCode;
+        }
+    });
+    if (!found || bestCode < 0)
+    {
+        return false;
+    }
+    code = (bestCode == 0 || bestCode + 1 > m_maxCode) ? 0 : bestCode + 1;
+    return true;
+}
+
+template <typename Visit>
+bool CheckersTablebase::ForEachChild(Checkers& game, Visit visit) const
+{
+    MoveList moves;
+    game.GenerateMoves(moves);
+    int player = game.GetCurrentPlayer();
+    for (int move : moves)
+    {
+        game.MakeMove(move);
+        bool found = true;
+        if (game.GetWinner() != IGame::Winner::OnGoing)
+        {
+            visit(1, -1);
+        }
+        else if (game.GetCurrentPlayer() == player)
+        {
+            found = ForEachChild(game, visit);
+        }
+        else
+        {
+            int code;
+            int sliceId;
+            found = Lookup(FromGame(game), code, &sliceId);
+            if (found)
+            {
+                visit(code, sliceId);
+            }
+        }
+        game.UnMakeMove();
+        if (!found)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int CheckersTablebase::SliceKey(int firstMen, int firstKings, int secondMen, int secondKings)
+{
+    return ((firstMen * 13 + firstKings) * 13 + secondMen) * 13 + secondKings;
+}
+
+uint64_t CheckersTablebase::SliceSize(int firstMen, int firstKings, int secondMen, int secondKings)
+{
+    int freeSquares = 32 - firstMen - secondMen;
+    return Choose(28, firstMen) * Choose(28, secondMen) * Choose(freeSquares, firstKings) * Choose(freeSquares - firstKings, secondKings);
+}
+
+CheckersTablebase::SlicePosition CheckersTablebase::FromGame(const Checkers& game)
+{
+    int player = game.GetCurrentPlayer();
+    SlicePosition position = { game.GetPieces(player), game.GetPieces(3 - player), game.GetKings() };
+    if (player == 2)
+    {
+        position = { Flip(position.Mover), Flip(position.Other), Flip(position.Kings) };
+    }
+    return position;
+}
+
+uint64_t CheckersTablebase::IndexOf(const SlicePosition& position)
+{
+    uint32_t moverMen = position.Mover & ~position.Kings;
+    uint32_t otherMen = position.Other & ~position.Kings;
+    uint32_t moverKings = position.Mover & position.Kings;
+    uint32_t otherKings = position.Other & position.Kings;
+    uint32_t men = moverMen | otherMen;
+    int freeSquares = 32 - PopCount(men);
+
+    uint64_t index = RankSquares(moverMen, MoverPromotionRow);
+    index = index * Choose(28, PopCount(otherMen)) + RankSquares(otherMen, OtherPromotionRow);
+    index = index * Choose(freeSquares, PopCount(moverKings)) + RankSquares(moverKings, men);
+    index = index * Choose(freeSquares - PopCount(moverKings), PopCount(otherKings)) + RankSquares(otherKings, men | moverKings);
+    return index;
+}
+
+bool CheckersTablebase::PositionAt(const Slice& slice, uint64_t index, SlicePosition& position)
+{
+    int freeSquares = 32 - slice.Men[0] - slice.Men[1];
+    uint64_t otherKingSets = Choose(freeSquares - slice.Kings[0], slice.Kings[1]);
+    uint64_t moverKingSets = Choose(freeSquares, slice.Kings[0]);
+    uint64_t otherMenSets = Choose(28, slice.Men[1]);
+
+    uint64_t otherKingsRank = index % otherKingSets;
+    index /= otherKingSets;
+    uint64_t moverKingsRank = index % moverKingSets;
+    index /= moverKingSets;
+    uint64_t otherMenRank = index % otherMenSets;
+    uint64_t moverMenRank = index / otherMenSets;
+
+    uint32_t moverMen = UnrankSquares(moverMenRank, slice.Men[0], MoverPromotionRow);
+    uint32_t otherMen = UnrankSquares(otherMenRank, slice.Men[1], OtherPromotionRow);
+    if (moverMen & otherMen)
+    {
+        return false;
+    }
+    uint32_t moverKings = UnrankSquares(moverKingsRank, slice.Kings[0], moverMen | otherMen);
+    uint32_t otherKings = UnrankSquares(otherKingsRank, slice.Kings[1], moverMen | otherMen | moverKings);
+    position = { moverMen | moverKings, otherMen | otherKings, moverKings | otherKings };
+    return true;
+}
+
+bool CheckersTablebase::Locate(const SlicePosition& position, int& sliceId, uint64_t& index) const
+{
+    int moverKings = PopCount(position.Mover & position.Kings);
+    int otherKings = PopCount(position.Other & position.Kings);
+    int moverMen = PopCount(position.Mover) - moverKings;
+    int otherMen = PopCount(position.Other) - otherKings;
+    sliceId = m_sliceIds[SliceKey(moverMen, moverKings, otherMen, otherKings)];
+    if (sliceId < 0)
+    {
+        return false;
+    }
+    index = IndexOf(position);
+    return true;
+}
+
+bool CheckersTablebase::Lookup(const SlicePosition& position, int& code, int* sliceIdOut) const
+{
+    int sliceId;
+    uint64_t index;
+    if (!Locate(position, sliceId, index))
+    {
+        return false;
+    }
+    if (sliceIdOut)
+    {
+        *sliceIdOut = sliceId;
+    }
+
+    if (!m_generated.empty())
+    {
+        code = m_generated[sliceId][index].load(std::memory_order_relaxed);
+    }
+    else
+    {
+        code = ReadCompressed(m_slices[sliceId], index);
+    }
+    return true;
+}
+
+uint8_t CheckersTablebase::ReadCompressed(const Slice& slice, uint64_t index) const
+{
+    // A block is stored as its values after a 0, or as (value, run length) pairs after a 1, whichever is shorter.
+    uint64_t block = slice.FirstBlock + index / m_blockSize;
+    int offset = static_cast<int>(index % m_blockSize);
+    const uint8_t* data = m_blockData + m_blockOffsets[block];
+    if (data[0] == 0)
+    {
+        return data[1 + offset];
+    }
+
+    const uint8_t* end = m_blockData + m_blockOffsets[block + 1];
+    for (const uint8_t* run = data + 1; run + 1 < end; run += 2)
+    {
+        if (offset < run[1])
+        {
+            return run[0];
+        }
+        offset -= run[1];
+    }
+    return 0;
+}
+
+int CheckersTablebase::SolveUnit(const std::vector<int>& unit)
+{
+    // Per slice of the unit: the pass in which results of lower slices decide a position, and one bit per position for
+    // this and the next pass, set when a position it leads to was just decided.
+    std::vector<std::unique_ptr<std::atomic<uint8_t>[]>> wake;
+    std::vector<std::unique_ptr<std::atomic<uint64_t>[]>> dirty[2];
+    std::vector<std::pair<int, uint64_t>> chunks;
+    for (size_t slot = 0; slot < unit.size(); ++slot)
+    {
+        uint64_t size = m_generatedSlices[unit[slot]].Size;
+        uint64_t words = (size + 63) / 64;
+        wake.emplace_back(new std::atomic<uint8_t>[size]);
+        for (uint64_t i = 0; i < size; ++i)
+        {
+            wake.back()[i].store(0, std::memory_order_relaxed);
+        }
+        for (auto& bits : dirty)
+        {
+            bits.emplace_back(new std::atomic<uint64_t>[words]);
+            for (uint64_t i = 0; i < words; ++i)
+            {
+                bits.back()[i].store(0, std::memory_order_relaxed);
+            }
+        }
+        for (uint64_t begin = 0; begin < size; begin += ChunkSize)
+        {
+            chunks.push_back({ static_cast<int>(slot), begin });
+        }
+    }
+    auto slotOf = [&](int sliceId)
+    {
+        return sliceId == unit[0] ? 0 : (unit.size() > 1 && sliceId == unit[1] ? 1 : -1);
+    };
+
+    // Pass k decides the positions k moves from the end: wins with a reply lost in k - 1 moves, losses where every reply
+    // wins in at most k - 1 moves and one in exactly k - 1. Only values under k count, so passes don't race with themselves.
+    // The first pass looks at every position; later ones only at those woken by a lower slice or marked by a decided child,
+    // whose parents in the unit are found by taking back the quiet moves that led to it.
+    int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    int maxWake = 0;
+    int passes = 0;
+    for (int pass = 0; pass < m_maxCode; ++pass)
+    {
+        passes++;
+        std::atomic<size_t> nextChunk(0);
+        std::atomic<uint64_t> marked(0);
+        auto work = [&]()
+        {
+            Checkers game;
+            uint64_t markedCount = 0;
+            for (size_t chunk = nextChunk++; chunk < chunks.size(); chunk = nextChunk++)
+            {
+                int slot = chunks[chunk].first;
+                const Slice& slice = m_generatedSlices[unit[slot]];
+                std::atomic<uint8_t>* values = m_generated[unit[slot]].get();
+                uint64_t end = std::min(slice.Size, chunks[chunk].second + ChunkSize);
+                uint64_t due = 0;
+                for (uint64_t index = chunks[chunk].second; index < end; ++index)
+                {
+                    if (index % 64 == 0)
+                    {
+                        due = pass == 0 ? ~0ull : dirty[pass % 2][slot][index / 64].exchange(0, std::memory_order_relaxed);
+                    }
+
+                    SlicePosition position;
+                    if ((!((due >> (index % 64)) & 1) && wake[slot][index].load(std::memory_order_relaxed) != pass)
+                        || values[index].load(std::memory_order_relaxed) != 0 || !PositionAt(slice, index, position))
+                    {
+                        continue;
+                    }
+
+                    game.SetPosition(position.Mover, position.Other, position.Kings, 1);
+                    bool win = false;
+                    bool loss = true;
+                    bool sameUnit = false;
+                    bool lowerDraw = false;
+                    int lowerWin = 0;
+                    int lowerLoss = 0;
+                    ForEachChild(game, [&](int childCode, int childSlice)
+                    {
+                        if (childCode == 0 || childCode - 1 >= pass)
+                        {
+                            loss = false;
+                        }
+                        else if ((childCode - 1) % 2 == 0)
+                        {
+                            win = true;
+                        }
+
+                        // A child's code is the pass in which it decides the position.
+                        if (pass == 0 && slotOf(childSlice) >= 0)
+                        {
+                            sameUnit = true;
+                        }
+                        else if (pass == 0 && childCode == 0)
+                        {
+                            lowerDraw = true;
+                        }
+                        else if (pass == 0 && (childCode - 1) % 2 == 0)
+                        {
+                            lowerWin = lowerWin == 0 ? childCode : std::min(lowerWin, childCode);
+                        }
+                        else if (pass == 0)
+                        {
+                            lowerLoss = std::max(lowerLoss, childCode);
+                        }
+                    });
+
+                    if (win || loss)
+                    {
+                        values[index].store(static_cast<uint8_t>(pass + 1), std::memory_order_relaxed);
+                        ForEachQuietParent(position.Mover, position.Other, position.Kings, [&](uint32_t mover, uint32_t other, uint32_t kings)
+                        {
+                            int parentSlice;
+                            uint64_t parentIndex;
+                            Locate({ mover, other, kings }, parentSlice, parentIndex);
+                            int parentSlot = slotOf(parentSlice);
+                            if (m_generated[parentSlice][parentIndex].load(std::memory_order_relaxed) == 0)
+                            {
+                                dirty[(pass + 1) % 2][parentSlot][parentIndex / 64].fetch_or(1ull << (parentIndex % 64), std::memory_order_relaxed);
+                                markedCount++;
+                            }
+                        });
+                    }
+                    else if (pass == 0)
+                    {
+                        int wakePass = lowerWin != 0 ? lowerWin : (lowerDraw ? 0 : lowerLoss);
+                        wake[slot][index].store(static_cast<uint8_t>(wakePass < m_maxCode ? wakePass : 0), std::memory_order_relaxed);
+                    }
+                }
+            }
+            marked += markedCount;
+        };
+
+        std::vector<std::thread> threads;
+        for (int i = 1; i < threadCount; ++i)
+        {
+            threads.emplace_back(work);
+        }
+        work();
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        if (pass == 0)
+        {
+            for (size_t slot = 0; slot < unit.size(); ++slot)
+            {
+                for (uint64_t i = 0; i < m_generatedSlices[unit[slot]].Size; ++i)
+                {
+                    maxWake = std::max<int>(maxWake, wake[slot][i].load(std::memory_order_relaxed));
+                }
+            }
+        }
+        if (marked == 0 && pass >= maxWake)
+        {
+            break;
+        }
+    }
+    return passes;
+}
+
+bool CheckersTablebase::BuildDatabase(const std::string& path, int size)
+{
+    int maxPieces = std::max(2, std::min(size, 2 * m_maxMen));
+    m_database.Close();
+    m_slices = nullptr;
+    m_maxPieces = maxPieces;
+    std::fill(m_sliceIds.begin(), m_sliceIds.end(), -1);
+    m_generated.clear();
+    m_generatedSlices.clear();
+
+    for (int pieces = 2; pieces <= maxPieces; ++pieces)
+    {
+        for (int firstMen = 0; firstMen <= std::min(pieces, m_maxMen); ++firstMen)
+        {
+            for (int firstKings = 0; firstMen + firstKings <= std::min(pieces - 1, m_maxMen); ++firstKings)
+            {
+                for (int secondMen = 0; firstMen + firstKings + secondMen <= pieces; ++secondMen)
+                {
+                    int secondKings = pieces - firstMen - firstKings - secondMen;
+                    if (firstMen + firstKings == 0 || secondMen + secondKings == 0 || secondMen + secondKings > m_maxMen)
+                    {
+                        continue;
+                    }
+
+                    Slice slice = {};
+                    slice.Men[0] = static_cast<uint8_t>(firstMen);
+                    slice.Kings[0] = static_cast<uint8_t>(firstKings);
+                    slice.Men[1] = static_cast<uint8_t>(secondMen);
+                    slice.Kings[1] = static_cast<uint8_t>(secondKings);
+                    slice.Size = SliceSize(firstMen, firstKings, secondMen, secondKings);
+                    m_sliceIds[SliceKey(firstMen, firstKings, secondMen, secondKings)] = static_cast<int>(m_generatedSlices.size());
+                    m_generatedSlices.push_back(slice);
+
+                    m_generated.emplace_back(new std::atomic<uint8_t>[slice.Size]);
+                    for (uint64_t i = 0; i < slice.Size; ++i)
+                    {
+                        m_generated.back()[i].store(0, std::memory_order_relaxed);
+                    }
+                }
+            }
+        }
+    }
+
+    // A move keeps the pieces or takes some, and turns men into kings; without either it reaches the colour-swapped slice.
+    // So slices are solved in pairs with their swapped counterpart, by pieces and then by men, after everything they lead to.
+    std::vector<std::vector<int>> units;
+    for (int sliceId = 0; sliceId < static_cast<int>(m_generatedSlices.size()); ++sliceId)
+    {
+        const Slice& slice = m_generatedSlices[sliceId];
+        int swappedId = m_sliceIds[SliceKey(slice.Men[1], slice.Kings[1], slice.Men[0], slice.Kings[0])];
+        if (swappedId == sliceId)
+        {
+            units.push_back({ sliceId });
+        }
+        else if (swappedId > sliceId)
+        {
+            units.push_back({ sliceId, swappedId });
+        }
+    }
+    auto unitOrder = [this](const std::vector<int>& unit)
+    {
+        const Slice& slice = m_generatedSlices[unit[0]];
+        int men = slice.Men[0] + slice.Men[1];
+        return std::make_pair(men + slice.Kings[0] + slice.Kings[1], men);
+    };
+    std::stable_sort(units.begin(), units.end(), [&](const std::vector<int>& a, const std::vector<int>& b)
+    {
+        return unitOrder(a) < unitOrder(b);
+    });
+
+    auto totalStart = std::chrono::steady_clock::now();
+    int maxCode = 0;
+    for (const std::vector<int>& unit : units)
+    {
+        auto start = std::chrono::steady_clock::now();
+        int passes = SolveUnit(unit);
+
+        uint64_t positions = 0;
+        uint64_t draws = 0;
+        for (int sliceId : unit)
+        {
+            const Slice& slice = m_generatedSlices[sliceId];
+            positions += slice.Size;
+            for (uint64_t i = 0; i < slice.Size; ++i)
+            {
+                int code = m_generated[sliceId][i].load(std::memory_order_relaxed);
+                maxCode = std::max(maxCode, code);
+                draws += code == 0 ? 1 : 0;
+            }
+        }
+
+        const Slice& slice = m_generatedSlices[unit[0]];
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "Solved " << int(slice.Men[0]) << " men " << int(slice.Kings[0]) << " kings v "
+            << int(slice.Men[1]) << " men " << int(slice.Kings[1]) << " kings: " << positions << " indices, "
+            << draws << " draws or unused, " << passes << " passes, " << elapsed.count() << " s\n";
+    }
+    std::chrono::duration<double> totalElapsed = std::chrono::steady_clock::now() - totalStart;
+    std::cout << "Generated " << maxPieces << " pieces in " << totalElapsed.count() << " s, longest result "
+        << std::max(0, maxCode - 1) << " moves\n";
+
+    bool written = WriteDatabase(path, maxPieces);
+    m_generated.clear();
+    m_generatedSlices.clear();
+    m_maxPieces = 0;
+    return written && LoadDatabase(path);
+}
+
+bool CheckersTablebase::WriteDatabase(const std::string& path, int maxPieces) const
+{
+    std::vector<Slice> slices = m_generatedSlices;
+    std::vector<uint64_t> offsets;
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> runs;
+    for (size_t sliceId = 0; sliceId < slices.size(); ++sliceId)
+    {
+        slices[sliceId].FirstBlock = offsets.size();
+        const std::atomic<uint8_t>* values = m_generated[sliceId].get();
+        for (uint64_t begin = 0; begin < slices[sliceId].Size; begin += m_blockSize)
+        {
+            uint64_t end = std::min(slices[sliceId].Size, begin + m_blockSize);
+            runs.clear();
+            for (uint64_t i = begin; i < end; ++i)
+            {
+                uint8_t value = values[i].load(std::memory_order_relaxed);
+                if (!runs.empty() && runs[runs.size() - 2] == value && runs.back() < 255)
+                {
+                    runs.back()++;
+                }
+                else
+                {
+                    runs.push_back(value);
+                    runs.push_back(1);
+                }
+            }
+
+            offsets.push_back(data.size());
+            if (runs.size() < end - begin)
+            {
+                data.push_back(1);
+                data.insert(data.end(), runs.begin(), runs.end());
+            }
+            else
+            {
+                data.push_back(0);
+                for (uint64_t i = begin; i < end; ++i)
+                {
+                    data.push_back(values[i].load(std::memory_order_relaxed));
+                }
+            }
+        }
+    }
+    uint64_t blockCount = offsets.size();
+    offsets.push_back(data.size());
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+    {
+        return false;
+    }
+
+    FileHeader header = {};
+    std::memcpy(header.Magic, DatabaseMagic, sizeof(header.Magic));
+    header.MaxPieces = static_cast<uint32_t>(maxPieces);
+    header.SliceCount = static_cast<uint32_t>(slices.size());
+    header.BlockSize = m_blockSize;
+    header.BlockCount = blockCount;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(slices.data()), slices.size() * sizeof(Slice));
+    out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    return static_cast<bool>(out);
+}
+
+bool CheckersTablebase::LoadDatabase(const std::string& path)
+{
+    m_slices = nullptr;
+    m_blockOffsets = nullptr;
+    m_blockData = nullptr;
+    m_maxPieces = 0;
+    std::fill(m_sliceIds.begin(), m_sliceIds.end(), -1);
+    if (!m_database.Open(path) || m_database.Size() < sizeof(FileHeader))
+    {
+        m_database.Close();
+        return false;
+    }
+
+    const FileHeader* header = static_cast<const FileHeader*>(m_database.Data());
+    size_t tablesSize = sizeof(FileHeader) + header->SliceCount * sizeof(Slice) + (header->BlockCount + 1) * sizeof(uint64_t);
+    if (std::memcmp(header->Magic, DatabaseMagic, sizeof(header->Magic)) != 0 || header->BlockSize != m_blockSize
+        || m_database.Size() < tablesSize)
+    {
+        m_database.Close();
+        return false;
+    }
+
+    const Slice* slices = reinterpret_cast<const Slice*>(header + 1);
+    const uint64_t* offsets = reinterpret_cast<const uint64_t*>(slices + header->SliceCount);
+    if (m_database.Size() != tablesSize + offsets[header->BlockCount])
+    {
+        m_database.Close();
+        return false;
+    }
+
+    for (uint32_t sliceId = 0; sliceId < header->SliceCount; ++sliceId)
+    {
+        const Slice& slice = slices[sliceId];
+        if (slice.Men[0] > m_maxMen || slice.Men[1] > m_maxMen || slice.Kings[0] > m_maxKings || slice.Kings[1] > m_maxKings
+            || slice.FirstBlock + (slice.Size + m_blockSize - 1) / m_blockSize > header->BlockCount)
+        {
+            std::fill(m_sliceIds.begin(), m_sliceIds.end(), -1);
+            m_database.Close();
+            return false;
+        }
+        m_sliceIds[SliceKey(slice.Men[0], slice.Kings[0], slice.Men[1], slice.Kings[1])] = static_cast<int>(sliceId);
+    }
+
+    m_slices = slices;
+    m_blockOffsets = offsets;
+    m_blockData = reinterpret_cast<const uint8_t*>(offsets + header->BlockCount + 1);
+    m_maxPieces = static_cast<int>(header->MaxPieces);
+    return true;
+}
\ No newline at end of file
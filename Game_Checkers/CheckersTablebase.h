@@ -0,0 +1,113 @@
+#pragma once
+#include "IGame.h"
+#include "Checkers.h"
+#include "../Trainer/Public/GameOracle.h"
+#include "../Trainer/Public/MappedFile.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define IGAME_API __declspec(dllexport)
+#else
+#define IGAME_API __attribute__((visibility("default")))
+#endif
+
+/// <summary>
+/// Checkers endgame tablebase: the number of moves to the end with perfect play for every position with few pieces,
+/// generated by retrograde analysis on all cores. Positions are stored from the side to move, in slices by their counts
+/// of men and kings, compressed in blocks with an offset index and mapped from the file, so probes touch only one block.
+/// </summary>
+class IGAME_API CheckersTablebase final : public GameOracle {
+public:
+    CheckersTablebase();
+
+    bool Probe(const IGame& state, float& value) const;
+    int BestMove(const IGame& state) const;
+    /// <summary>Probe answers positions with at most this many pieces, as far as the loaded tables reach.</summary>
+    void SetProbeLimit(int limit);
+    int GetProbeLimit() const;
+    /// <summary>Generates the tables of every position with at most the given number of pieces, writes them and maps the file.</summary>
+    bool BuildDatabase(const std::string& path, int size);
+    bool LoadDatabase(const std::string& path);
+    /// <summary>Most pieces the loaded tables cover, 0 when none are loaded.</summary>
+    int GetMaxPieces() const;
+
+    /// <summary>
+    /// Result for the player to move with perfect play: 0 for a draw, otherwise the number of complete moves, multi-captures
+    /// counting as one, until the game ends plus one. Odd numbers of moves are wins for the player to move, even ones losses.
+    /// Returns false when the position is not in the tables.
+    /// </summary>
+    bool ProbeDistance(const Checkers& game, int& code) const;
+
+private:
+    static const int m_maxMen = 12;
+    static const int m_maxKings = 12;
+    /// <summary>Positions per compressed block; a probe decodes at most one block.</summary>
+    static const int m_blockSize = 1024;
+    /// <summary>Values are one byte, so longer wins are not told apart from draws.</summary>
+    static const int m_maxCode = 255;
+
+    struct FileHeader {
+        char Magic[8];
+        uint32_t MaxPieces;
+        uint32_t SliceCount;
+        uint32_t BlockSize;
+        uint32_t Reserved;
+        uint64_t BlockCount;
+    };
+
+    /// <summary>Positions with the given pieces and the first side to move; the first side's men move towards row 0.</summary>
+    struct Slice {
+        uint8_t Men[2];
+        uint8_t Kings[2];
+        uint32_t Reserved;
+        uint64_t Size;
+        uint64_t FirstBlock;
+    };
+
+    /// <summary>A position of a slice decoded from its index, boards already seen from the side to move.</summary>
+    struct SlicePosition {
+        uint32_t Mover;
+        uint32_t Other;
+        uint32_t Kings;
+    };
+
+    int m_probeLimit = 32;
+    int m_maxPieces = 0;
+
+    MappedFile m_database;
+    const Slice* m_slices = nullptr;
+    const uint64_t* m_blockOffsets = nullptr;
+    const uint8_t* m_blockData = nullptr;
+    /// <summary>Slice number by SliceKey, -1 for slices not in the tables.</summary>
+    std::vector<int> m_sliceIds;
+
+    /// <summary>Values of all slices while the tables are generated, by slice number.</summary>
+    std::vector<std::unique_ptr<std::atomic<uint8_t>[]>> m_generated;
+    std::vector<Slice> m_generatedSlices;
+
+    static int SliceKey(int firstMen, int firstKings, int secondMen, int secondKings);
+    static uint64_t SliceSize(int firstMen, int firstKings, int secondMen, int secondKings);
+    /// <summary>Boards of the player to move, turned around when it is the second player so that they move like the first.</summary>
+    static SlicePosition FromGame(const Checkers& game);
+    static uint64_t IndexOf(const SlicePosition& position);
+    /// <summary>Decodes an index of the slice; false for indices where men of both sides would share a square.</summary>
+    static bool PositionAt(const Slice& slice, uint64_t index, SlicePosition& position);
+    bool Locate(const SlicePosition& position, int& sliceId, uint64_t& index) const;
+    /// <summary>The value of the position in the generated or the loaded tables; false when its slice is missing.</summary>
+    bool Lookup(const SlicePosition& position, int& code, int* sliceId = nullptr) const;
+    uint8_t ReadCompressed(const Slice& slice, uint64_t index) const;
+
+    /// <summary>Solves the slices of one unit, a slice and its colour-swapped counterpart, whose positions lead into each other.
+    /// Returns the number of passes.</summary>
+    int SolveUnit(const std::vector<int>& unit);
+    bool WriteDatabase(const std::string& path, int maxPieces) const;
+
+    /// <summary>Calls visit for every position the player to move can reach with one complete move, multi-captures played out,
+    /// with the reached position's value and slice, or with 1 and -1 when the move ends the game.</summary>
+    template <typename Visit>
+    bool ForEachChild(Checkers& game, Visit visit) const;
+};
\ No newline at end of file
@@ -1,10 +1,20 @@
 #include "pch.h"
 #include "Checkers.h"
+#include "CheckersTablebase.h"
+#include "../Trainer/Public/SimulationEngine.h"
 
-extern "C" __declspec(dllexport) const char* GetGameName() {
+extern "C" IGAME_API const char* GetGameName() {
     return "Checkers";
 }
 
-extern "C" __declspec(dllexport) IGame * CreateGame() {
+extern "C" IGAME_API IGame * CreateGame() {
     return new Checkers();
+}
+
+extern "C" IGAME_API SimulationEngine * CreateSimulationEngine() {
+    return new GameSimulationEngine<Checkers>();
+}
+
+extern "C" IGAME_API GameOracle * CreateGameOracle() {
+    return new CheckersTablebase();
 }
\ No newline at end of file
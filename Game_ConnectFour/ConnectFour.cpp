@@ -1,12 +1,14 @@
 #include "pch.h"
 #include "ConnectFour.h"
+#include "../Trainer/Public/ZobristKeys.h"
 #include <iostream>
+#include <algorithm>
+#include <cassert>
 
-ConnectFour::ConnectFour(const ConnectFour& other)
+namespace
 {
-    m_board = other.m_board;                      
-    m_currentPlayer = other.m_currentPlayer;      
-    m_winner = other.m_winner;                    
+    /// <summary>Zobrist keys, one per player and bitboard position.</summary>
+    constexpr ZobristTable<2, 64> Zobrist(0xC4C4C4C4ull);
 }
 
 std::unordered_map<int, std::string> ConnectFour::GetSpritePaths() const
@@ -27,7 +29,7 @@ std::vector<std::vector<int>> ConnectFour::GetSpriteGrid() const
     {
         for (int y = 0; y < m_cols; ++y)
         {
-            switch (m_board[x][y])
+            switch (GetCell(x, y))
             {
             case 1: 
                 grid[x][y] = 1; 
@@ -72,10 +74,16 @@ ConnectFour::ConnectFour()
 
 void ConnectFour::Reset() 
 {
-    m_board = std::vector<std::vector<int>>(m_rows, std::vector<int>(m_cols, 0));
+    m_playerMasks[0] = 0;
+    m_playerMasks[1] = 0;
+    for (int col = 0; col < m_cols; ++col)
+    {
+        m_heights[col] = 0;
+    }
     m_currentPlayer = 1;
     m_winner = Winner::OnGoing; 
-    m_moveHistory.clear();
+    m_moveCount = 0;
+    m_hash = ComputeHash();
 }
 
 bool ConnectFour::MakeMove(int x, int y) 
@@ -85,33 +93,7 @@ bool ConnectFour::MakeMove(int x, int y)
         return false;
     }
 
-    if (m_board[0][y] != 0) 
-    {
-        return false;
-    }
-
-    for (int row = m_rows - 1; row >= 0; --row) 
-    {
-        if (m_board[row][y] == 0) 
-        {
-            m_board[row][y] = m_currentPlayer;
-
-            if (CheckWin(row, y)) 
-            {
-                m_winner = static_cast<Winner>(m_currentPlayer);
-            }
-            else if (IsBoardFull()) 
-            {
-                m_winner = Winner::Draw;
-            }
-            m_currentPlayer = 3 - m_currentPlayer;
-
-            m_moveHistory.push_back(y);
-            return true;
-        }
-    }
-
-    return false;
+    return PlacePiece(y);
 }
 
 bool ConnectFour::MakeMove(int column) 
@@ -121,55 +103,48 @@ bool ConnectFour::MakeMove(int column)
         return false;
     }
 
-    for (int row = m_rows - 1; row >= 0; --row) 
-    {
-        if (m_board[row][column] == 0)
-        {
-            m_board[row][column] = m_currentPlayer;
-            if (CheckWin(row, column)) 
-            {
-                m_winner = static_cast<Winner>(m_currentPlayer);
-            }
-            else if (IsBoardFull()) 
-            {
-                m_winner = Winner::Draw;
-            }
-            m_currentPlayer = 3 - m_currentPlayer;
-            m_moveHistory.push_back(column);
-            return true;
-        }
-    }
-
-    return false;
+    return PlacePiece(column);
 }
 
-bool ConnectFour::UnMakeMove()
+bool ConnectFour::PlacePiece(int column)
 {
-    if (m_moveHistory.empty()) 
+    if (m_heights[column] == m_rows)
     {
         return false;
     }
 
-    int lastMoveColumn = m_moveHistory.back();
-    m_moveHistory.pop_back();
-
-    int row = -1;
-    for (int i = 0; i < m_rows; ++i) 
+    int bit = column * m_columnBits + m_heights[column];
+    uint64_t cell = 1ull << bit;
+    m_playerMasks[m_currentPlayer - 1] |= cell;
+    m_hash ^= Zobrist.Keys[m_currentPlayer - 1][bit] ^ Zobrist.SecondPlayerToMove;
+    m_heights[column]++;
+    if (CheckWin(cell)) 
     {
-        if (m_board[i][lastMoveColumn] != 0) 
-        {
-            row = i;
-            break;
-        }
+        m_winner = static_cast<Winner>(m_currentPlayer);
+    }
+    else if (IsBoardFull()) 
+    {
+        m_winner = Winner::Draw;
     }
+    m_currentPlayer = 3 - m_currentPlayer;
+    m_moveHistory[m_moveCount++] = column;
+    return true;
+}
 
-    if (row == -1) 
+bool ConnectFour::UnMakeMove()
+{
+    if (m_moveCount == 0) 
     {
         return false;
     }
 
-    m_board[row][lastMoveColumn] = 0;
+    int lastMoveColumn = m_moveHistory[--m_moveCount];
+    int bit = lastMoveColumn * m_columnBits + --m_heights[lastMoveColumn];
+    uint64_t cell = 1ull << bit;
+    m_playerMasks[0] &= ~cell;
+    m_playerMasks[1] &= ~cell;
     m_currentPlayer = 3 - m_currentPlayer;
+    m_hash ^= Zobrist.Keys[m_currentPlayer - 1][bit] ^ Zobrist.SecondPlayerToMove;
     m_winner = Winner::OnGoing;
     return true;
 }
@@ -179,21 +154,22 @@ IGame::Winner ConnectFour::GetWinner() const
     return m_winner;
 }
 
-std::vector<int> ConnectFour::GetValidMoves() const 
+int ConnectFour::GenerateMoves(MoveList& moves) const 
 {
-    std::vector<int> moves;
+    moves.Count = 0;
     if (m_winner != IGame::Winner::OnGoing)
     {
-        return moves;
+        return 0;
     }
+    int mask = ValidMoveMask();
     for (int col = 0; col < m_cols; ++col) 
     {
-        if (m_board[0][col] == 0) 
+        if (mask & (1 << col)) 
         {
-            moves.push_back(col);
+            moves.Moves[moves.Count++] = col;
         }
     }
-    return moves;
+    return moves.Count;
 }
 
 int ConnectFour::GetCurrentPlayer() const 
@@ -201,14 +177,81 @@ int ConnectFour::GetCurrentPlayer() const
     return m_currentPlayer;
 }
 
+uint64_t ConnectFour::GetStones(int player) const
+{
+    return m_playerMasks[player - 1];
+}
+
+uint64_t ConnectFour::GetHash() const
+{
+    // Debug builds recompute the hash on every call.
+    assert(m_hash == ComputeHash());
+    return m_hash;
+}
+
+uint64_t ConnectFour::ComputeHash(int transform) const
+{
+    uint64_t hash = m_currentPlayer == 2 ? Zobrist.SecondPlayerToMove : 0;
+    for (int player = 0; player < 2; ++player)
+    {
+        for (int bit = 0; bit < 64; ++bit)
+        {
+            if ((m_playerMasks[player] >> bit) & 1)
+            {
+                int column = TransformMove(bit / m_columnBits, transform);
+                hash ^= Zobrist.Keys[player][column * m_columnBits + bit % m_columnBits];
+            }
+        }
+    }
+    return hash;
+}
+
+// Transform 1 mirrors the board left to right.
+int ConnectFour::SymmetryCount() const
+{
+    return 2;
+}
+
+uint64_t ConnectFour::GetSymmetricHash(int transform) const
+{
+    return transform == 0 ? m_hash : ComputeHash(transform);
+}
+
+int ConnectFour::TransformMove(int move, int transform) const
+{
+    return transform == 0 ? move : m_cols - 1 - move;
+}
+
+int ConnectFour::InverseTransform(int transform) const
+{
+    return transform;
+}
+
+bool ConnectFour::SwapsPlayers(int) const
+{
+    return false;
+}
+
+void ConnectFour::EncodeSymmetricState(float* state, int transform) const
+{
+    EncodeState(state);
+    if (transform != 0)
+    {
+        for (int r = 0; r < m_rows; ++r)
+        {
+            std::reverse(state + r * m_cols, state + (r + 1) * m_cols);
+        }
+    }
+}
+
 std::vector<float> ConnectFour::GetState() const 
 {
     std::vector<float> state;
-    for (const auto& row : m_board) 
+    for (int r = 0; r < m_rows; ++r) 
     {
-        for (int cell : row) 
+        for (int c = 0; c < m_cols; ++c) 
         {
-            state.push_back(static_cast<float>(cell));
+            state.push_back(static_cast<float>(GetCell(r, c)));
         }
     }
     return state;
@@ -216,56 +259,53 @@ std::vector<float> ConnectFour::GetState() const
 
 bool ConnectFour::IsBoardFull() const 
 {
+    return (m_playerMasks[0] | m_playerMasks[1]) == m_boardMask;
+}
+
+int ConnectFour::ValidMoveMask() const
+{
+    // Adding the bottom row to a column lands on its first free cell, or on the guard bit when it is full.
+    uint64_t freeCells = ((m_playerMasks[0] | m_playerMasks[1]) + m_bottomMask) & m_boardMask;
+    int mask = 0;
     for (int col = 0; col < m_cols; ++col)
     {
-        if (m_board[0][col] == 0)
+        if ((freeCells >> (col * m_columnBits)) & ((1ull << m_rows) - 1))
         {
-            return false;
+            mask |= 1 << col;
         }
     }
-    return true;
+    return mask;
 }
 
-bool ConnectFour::CheckWin(int row, int col) 
+int ConnectFour::GetCell(int row, int col) const
 {
-    int player = m_board[row][col];
-    if (player == 0)
+    uint64_t cell = 1ull << (col * m_columnBits + (m_rows - 1 - row));
+    if (m_playerMasks[0] & cell)
     {
-        return false;
+        return 1;
     }
-
-    static const int directions[4][2] = {
-        {0, 1}, 
-        {1, 0}, 
-        {1, 1}, 
-        {1, -1} 
-    };
-
-    for (int i = 0; i < 4; ++i) 
+    if (m_playerMasks[1] & cell)
     {
-        int dr = directions[i][0];
-        int dc = directions[i][1];
-        int count = 1;
+        return 2;
+    }
+    return 0;
+}
 
-        int r = row + dr;
-        int c = col + dc;
-        while (r >= 0 && r < m_rows && c >= 0 && c < m_cols && m_board[r][c] == player) 
-        {
-            count++;
-            r += dr;
-            c += dc;
-        }
+bool ConnectFour::CheckWin(uint64_t placedCell) const
+{
+    uint64_t pieces = m_playerMasks[m_currentPlayer - 1];
 
-        r = row - dr;
-        c = col - dc;
-        while (r >= 0 && r < m_rows && c >= 0 && c < m_cols && m_board[r][c] == player)
-        {
-            count++;
-            r -= dr;
-            c -= dc;
-        }
+    // Vertical, horizontal and both diagonals. The guard bit of every column keeps lines from wrapping around.
+    static const int shifts[4] = { 1, m_columnBits, m_columnBits - 1, m_columnBits + 1 };
 
-        if (count >= 4)
+    for (int i = 0; i < 4; ++i) 
+    {
+        int shift = shifts[i];
+        uint64_t pairs = pieces & (pieces >> shift);
+        uint64_t fourStarts = pairs & (pairs >> (2 * shift));
+        // Only lines through the placed piece count, like the old cell walk.
+        uint64_t startsThroughCell = placedCell | (placedCell >> shift) | (placedCell >> (2 * shift)) | (placedCell >> (3 * shift));
+        if (fourStarts & startsThroughCell)
         {
             return true;
         }
@@ -278,10 +318,11 @@ bool ConnectFour::CheckWin(int row, int col)
 
 void ConnectFour::PrintBoard() const 
 {
-    for (const auto& row : m_board) 
+    for (int r = 0; r < m_rows; ++r) 
     {
-        for (int cell : row)
+        for (int c = 0; c < m_cols; ++c)
         {
+            int cell = GetCell(r, c);
             char symbol = '.';
             if (cell == 1) symbol = 'X';
             else if (cell == 2) symbol = 'O';
@@ -292,26 +333,25 @@ void ConnectFour::PrintBoard() const
     std::cout << "0 1 2 3 4 5 6\n\n";
 }
 
-std::vector<float> ConnectFour::GetBoardState() const 
+int ConnectFour::StateSize() const
 {
-    std::vector<float> state(m_rows * m_cols, 0.0f);
-    for (int r = 0; r < m_rows; ++r) 
+    return m_rows * m_cols + 1;
+}
+
+void ConnectFour::EncodeState(float* state) const 
+{
+    // Cells row by row from the top, +1 and -1 for the players, then the player to move.
+    std::fill(state, state + m_rows * m_cols, 0.0f);
+    for (int bit = 0; bit < m_cols * m_columnBits; ++bit)
     {
-        for (int c = 0; c < m_cols; ++c) 
+        uint64_t cell = 1ull << bit;
+        if ((m_playerMasks[0] | m_playerMasks[1]) & cell)
         {
-            int index = r * m_cols + c;
-            if (m_board[r][c] == 1) 
-            {
-                state[index] = 1.0f;
-            }
-            else if (m_board[r][c] == 2) 
-            {
-                state[index] = -1.0f;
-            }
+            int index = (m_rows - 1 - bit % m_columnBits) * m_cols + bit / m_columnBits;
+            state[index] = (m_playerMasks[0] & cell) ? 1.0f : -1.0f;
         }
     }
-    state.push_back(static_cast<float>(m_currentPlayer));
-    return state;
+    state[m_rows * m_cols] = static_cast<float>(m_currentPlayer);
 }
 
 std::string ConnectFour::GetName() const
@@ -324,5 +364,10 @@ std::unique_ptr<IGame> ConnectFour::Clone() const
     return std::make_unique<ConnectFour>(*this);
 }
 
+void ConnectFour::CopyFrom(const IGame& other)
+{
+    *this = static_cast<const ConnectFour&>(other);
+}
+
 
 
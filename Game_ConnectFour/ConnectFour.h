@@ -1,13 +1,20 @@
 #pragma once
 #include "IGame.h"
 #include <vector>
+#include <cstdint>
 
+#ifdef _WIN32
 #define IGAME_API __declspec(dllexport)
+#else
+#define IGAME_API __attribute__((visibility("default")))
+#endif
 
-class IGAME_API ConnectFour : public IGame {
+class IGAME_API ConnectFour final : public IGame {
 public:
     ConnectFour();
-    ConnectFour(const ConnectFour& other);
+    /// <summary>The state is fixed-size arrays and scalars only, so copies are flat and keep the undo history.</summary>
+    ConnectFour(const ConnectFour&) = default;
+    ConnectFour& operator=(const ConnectFour&) = default;
     std::unordered_map<int, std::string> GetSpritePaths() const;
     std::vector<std::vector<int>> GetSpriteGrid() const;
     bool InterpretAndMakeMove(const std::string& moveStr);
@@ -16,14 +23,25 @@ public:
     bool MakeMove(int column);
     bool UnMakeMove();
     Winner GetWinner() const;
-    std::vector<int> GetValidMoves() const;
+    int GenerateMoves(MoveList& moves) const;
     std::vector<float> GetState() const;
     int GetCurrentPlayer() const;
+    /// <summary>Bitboard of the player's stones, bit column * 7 + height.</summary>
+    uint64_t GetStones(int player) const;
+    uint64_t GetHash() const;
+    int SymmetryCount() const;
+    uint64_t GetSymmetricHash(int transform) const;
+    int TransformMove(int move, int transform) const;
+    int InverseTransform(int transform) const;
+    bool SwapsPlayers(int transform) const;
+    void EncodeSymmetricState(float* state, int transform) const;
 
     void PrintBoard() const;
 
     std::unique_ptr<IGame> Clone() const;
-    std::vector<float> GetBoardState() const;
+    void CopyFrom(const IGame& other);
+    int StateSize() const;
+    void EncodeState(float* state) const;
 
     std::string GetName() const;
 
@@ -32,11 +50,26 @@ public:
 private:
     static const int m_rows = 6;
     static const int m_cols = 7;
-    std::vector<std::vector<int>> m_board; // 0 = empty, 1 = player 1, 2 = player 2
+    /// <summary>Bits per column in the bitboards: six cells from the bottom up plus an always empty guard bit.</summary>
+    static const int m_columnBits = m_rows + 1;
+    static const uint64_t m_bottomMask = 0x0040810204081ull;
+    static const uint64_t m_boardMask = m_bottomMask * ((1ull << m_rows) - 1);
+
+    uint64_t m_playerMasks[2]; // bit column * m_columnBits + height, one mask per player
+    int m_heights[m_cols];
     int m_currentPlayer;
     Winner m_winner;
-    std::vector<int> m_moveHistory;
+    int m_moveHistory[m_rows * m_cols];
+    int m_moveCount;
+    uint64_t m_hash;
 
-    bool CheckWin(int lastRow, int lastCol);
+    bool CheckWin(uint64_t placedCell) const;
     bool IsBoardFull() const;
+    /// <summary>Columns that still have room, as a bitmask with bit i for column i.</summary>
+    int ValidMoveMask() const;
+    /// <summary>0 for empty, otherwise the player owning the cell. Row 0 is the top row.</summary>
+    int GetCell(int row, int col) const;
+    bool PlacePiece(int column);
+    /// <summary>The position hash built from scratch, to check the incremental one, or of the position mapped through a symmetry.</summary>
+    uint64_t ComputeHash(int transform = 0) const;
 };
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "pch.h"
+#include "ConnectFourBatchEnv.h"
+#include <algorithm>
+
+ConnectFourBatchEnv::ConnectFourBatchEnv(int games)
+    : m_firstPlayer(games), m_secondPlayer(games), m_currentPlayer(games), m_moveCount(games)
+{
+    Reset();
+}
+
+int ConnectFourBatchEnv::Size() const
+{
+    return static_cast<int>(m_currentPlayer.size());
+}
+
+int ConnectFourBatchEnv::StateSize() const
+{
+    return EncodedSize;
+}
+
+void ConnectFourBatchEnv::Reset()
+{
+    for (int game = 0; game < Size(); ++game)
+    {
+        ResetGame(game);
+    }
+}
+
+void ConnectFourBatchEnv::ResetGame(int game)
+{
+    m_firstPlayer[game] = 0;
+    m_secondPlayer[game] = 0;
+    m_currentPlayer[game] = 1;
+    m_moveCount[game] = 0;
+}
+
+bool ConnectFourBatchEnv::HasFour(uint64_t pieces)
+{
+    // Vertical, horizontal and both diagonals; the guard bit of every column keeps lines from wrapping around.
+    static const int shifts[4] = { 1, m_columnBits, m_columnBits - 1, m_columnBits + 1 };
+    for (int i = 0; i < 4; ++i)
+    {
+        uint64_t pairs = pieces & (pieces >> shifts[i]);
+        if (pairs & (pairs >> (2 * shifts[i])))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int ConnectFourBatchEnv::Step(const int* moves, int* winners)
+{
+    int illegalMoves = 0;
+    for (int game = 0; game < Size(); ++game)
+    {
+        winners[game] = IGame::Winner::OnGoing;
+        int column = moves[game];
+        if (column < 0 || column >= m_cols)
+        {
+            illegalMoves++;
+            continue;
+        }
+
+        // Adding the column's bottom cell to its stones lands on the first free cell, or on the guard bit when it is full.
+        uint64_t columnMask = ((1ull << m_rows) - 1) << (column * m_columnBits);
+        uint64_t cell = ((m_firstPlayer[game] | m_secondPlayer[game]) + (1ull << (column * m_columnBits))) & columnMask;
+        if (cell == 0)
+        {
+            illegalMoves++;
+            continue;
+        }
+
+        uint64_t& pieces = m_currentPlayer[game] == 1 ? m_firstPlayer[game] : m_secondPlayer[game];
+        pieces |= cell;
+        m_moveCount[game]++;
+
+        if (HasFour(pieces))
+        {
+            winners[game] = m_currentPlayer[game];
+        }
+        else if (m_moveCount[game] == m_rows * m_cols)
+        {
+            winners[game] = IGame::Winner::Draw;
+        }
+
+        if (winners[game] != IGame::Winner::OnGoing)
+        {
+            ResetGame(game);
+        }
+        else
+        {
+            m_currentPlayer[game] = 3 - m_currentPlayer[game];
+        }
+    }
+    return illegalMoves;
+}
+
+void ConnectFourBatchEnv::EncodeStates(float* states) const
+{
+    for (int game = 0; game < Size(); ++game)
+    {
+        float* state = states + static_cast<size_t>(game) * EncodedSize;
+        std::fill(state, state + m_rows * m_cols, 0.0f);
+        uint64_t occupied = m_firstPlayer[game] | m_secondPlayer[game];
+        for (int bit = 0; bit < m_cols * m_columnBits; ++bit)
+        {
+            uint64_t cell = 1ull << bit;
+            if (occupied & cell)
+            {
+                int index = (m_rows - 1 - bit % m_columnBits) * m_cols + bit / m_columnBits;
+                state[index] = (m_firstPlayer[game] & cell) ? 1.0f : -1.0f;
+            }
+        }
+        state[m_rows * m_cols] = static_cast<float>(m_currentPlayer[game]);
+    }
+}
+
+void ConnectFourBatchEnv::SampleRandomMoves(std::mt19937& rng, int* moves) const
+{
+    for (int game = 0; game < Size(); ++game)
+    {
+        int mask = ValidMoveMask(game);
+        int columns[m_cols];
+        int count = 0;
+        for (int col = 0; col < m_cols; ++col)
+        {
+            if (mask & (1 << col))
+            {
+                columns[count++] = col;
+            }
+        }
+        moves[game] = columns[std::uniform_int_distribution<int>(0, count - 1)(rng)];
+    }
+}
+
+int ConnectFourBatchEnv::ValidMoveMask(int game) const
+{
+    uint64_t freeCells = ((m_firstPlayer[game] | m_secondPlayer[game]) + m_bottomMask) & m_boardMask;
+    int mask = 0;
+    for (int col = 0; col < m_cols; ++col)
+    {
+        if ((freeCells >> (col * m_columnBits)) & ((1ull << m_rows) - 1))
+        {
+            mask |= 1 << col;
+        }
+    }
+    return mask;
+}
+
+int ConnectFourBatchEnv::GetCurrentPlayer(int game) const
+{
+    return m_currentPlayer[game];
+}
\ No newline at end of file
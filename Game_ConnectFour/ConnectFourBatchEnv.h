@@ -0,0 +1,57 @@
+#pragma once
+#include "IGame.h"
+#include "../Trainer/Public/BatchEnvironment.h"
+#include <vector>
+#include <random>
+#include <cstdint>
+
+#ifdef _WIN32
+#define IGAME_API __declspec(dllexport)
+#else
+#define IGAME_API __attribute__((visibility("default")))
+#endif
+
+/// <summary>
+/// Many ConnectFour games stepped together for self-play and evaluation. The games are stored as arrays of
+/// bitboards in the same layout as ConnectFour, and a finished game starts over right after its result is reported.
+/// </summary>
+class IGAME_API ConnectFourBatchEnv final : public BatchEnvironment {
+public:
+    /// <summary>Floats per game written by EncodeStates, the same encoding as ConnectFour::EncodeState.</summary>
+    static const int EncodedSize = 6 * 7 + 1;
+
+    ConnectFourBatchEnv(int games);
+
+    int Size() const;
+    int StateSize() const;
+    /// <summary>Starts every game over.</summary>
+    void Reset();
+    /// <summary>
+    /// Plays one column per game for the player to move. Winners receives one IGame::Winner per game; games that
+    /// ended are reset afterwards. A move into a full or nonexistent column leaves its game unchanged and reports OnGoing.
+    /// Returns the number of such illegal moves.
+    /// </summary>
+    int Step(const int* moves, int* winners);
+    /// <summary>Writes Size() * EncodedSize floats, one state per game.</summary>
+    void EncodeStates(float* states) const;
+    /// <summary>Picks a uniformly random legal column for every game.</summary>
+    void SampleRandomMoves(std::mt19937& rng, int* moves) const;
+    /// <summary>Columns of the game that still have room, bit i for column i.</summary>
+    int ValidMoveMask(int game) const;
+    int GetCurrentPlayer(int game) const;
+
+private:
+    static const int m_rows = 6;
+    static const int m_cols = 7;
+    static const int m_columnBits = m_rows + 1;
+    static const uint64_t m_bottomMask = 0x0040810204081ull;
+    static const uint64_t m_boardMask = m_bottomMask * ((1ull << m_rows) - 1);
+
+    std::vector<uint64_t> m_firstPlayer;
+    std::vector<uint64_t> m_secondPlayer;
+    std::vector<uint8_t> m_currentPlayer;
+    std::vector<uint8_t> m_moveCount;
+
+    static bool HasFour(uint64_t pieces);
+    void ResetGame(int game);
+};
\ No newline at end of file
@@ -0,0 +1,472 @@
+#include "pch.h"
+#include "ConnectFourSolver.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+    const char DatabaseMagic[8] = { 'C', '4', 'S', 'O', 'L', 'V', 'E', '1' };
+    /// <summary>Columns from the center outwards, the usual strength of a move before threats are counted.</summary>
+    const int ColumnOrder[7] = { 3, 2, 4, 1, 5, 0, 6 };
+}
+
+ConnectFourSolver::ConnectFourSolver(size_t tableBytes)
+{
+    m_tableBits = 1;
+    while ((static_cast<size_t>(2) << m_tableBits) * sizeof(uint64_t) <= tableBytes)
+    {
+        m_tableBits++;
+    }
+    size_t entries = static_cast<size_t>(1) << m_tableBits;
+    m_table.reset(new std::atomic<uint64_t>[entries]);
+    for (size_t i = 0; i < entries; ++i)
+    {
+        m_table[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+ConnectFourSolver::Position ConnectFourSolver::FromGame(const ConnectFour& game)
+{
+    Position position;
+    position.Current = game.GetStones(game.GetCurrentPlayer());
+    position.Mask = game.GetStones(1) | game.GetStones(2);
+    position.Moves = PopCount(position.Mask);
+    return position;
+}
+
+bool ConnectFourSolver::Probe(const IGame& state, float& value) const
+{
+    if (state.GetWinner() != IGame::Winner::OnGoing)
+    {
+        value = state.GetWinner() == IGame::Winner::FirstPlayer ? 1.0f : (state.GetWinner() == IGame::Winner::SecondPlayer ? -1.0f : 0.0f);
+        return true;
+    }
+
+    Position position = FromGame(static_cast<const ConnectFour&>(state));
+    int score;
+    if (!ProbeDatabase(position, score))
+    {
+        if (m_rows * m_cols - position.Moves > m_probeLimit)
+        {
+            return false;
+        }
+        score = Solve(position);
+    }
+
+    float result = score > 0 ? 1.0f : (score < 0 ? -1.0f : 0.0f);
+    value = state.GetCurrentPlayer() == 1 ? result : -result;
+    return true;
+}
+
+int ConnectFourSolver::BestMove(const IGame& state) const
+{
+    if (state.GetWinner() != IGame::Winner::OnGoing)
+    {
+        return -1;
+    }
+
+    Position position = FromGame(static_cast<const ConnectFour&>(state));
+    int score;
+    if (!ProbeDatabase(position, score) && m_rows * m_cols - position.Moves > m_probeLimit)
+    {
+        return -1;
+    }
+
+    uint64_t possible = PossibleMoves(position);
+    uint64_t winning = WinningCells(position.Current, position.Mask) & possible;
+    int bestMove = -1;
+    int bestScore = -m_rows * m_cols;
+    for (int column : ColumnOrder)
+    {
+        uint64_t move = possible & ColumnMask(column);
+        if (!move)
+        {
+            continue;
+        }
+        if (move & winning)
+        {
+            return column;
+        }
+
+        // Same reach as Probe: a child the database doesn't hold is only solved within the probe limit.
+        Position child = Play(position, move);
+        int childScore;
+        if (!ProbeDatabase(child, childScore))
+        {
+            if (m_rows * m_cols - child.Moves > m_probeLimit)
+            {
+                return -1;
+            }
+            childScore = Solve(child);
+        }
+
+        int score = -childScore;
+        if (bestMove < 0 || score > bestScore)
+        {
+            bestMove = column;
+            bestScore = score;
+        }
+    }
+    return bestMove;
+}
+
+void ConnectFourSolver::SetProbeLimit(int limit)
+{
+    m_probeLimit = limit;
+}
+
+int ConnectFourSolver::GetProbeLimit() const
+{
+    return m_probeLimit;
+}
+
+int ConnectFourSolver::Solve(const Position& position) const
+{
+    if (CanWinNext(position))
+    {
+        return (m_rows * m_cols + 1 - position.Moves) / 2;
+    }
+
+    // Null-window searches narrow the range until the exact score is known.
+    int min = -(m_rows * m_cols - position.Moves) / 2;
+    int max = (m_rows * m_cols + 1 - position.Moves) / 2;
+    while (min < max)
+    {
+        int med = min + (max - min) / 2;
+        if (med <= 0 && min / 2 < med)
+        {
+            med = min / 2;
+        }
+        else if (med >= 0 && max / 2 > med)
+        {
+            med = max / 2;
+        }
+
+        int result = Negamax(position, med, med + 1);
+        if (result <= med)
+        {
+            max = result;
+        }
+        else
+        {
+            min = result;
+        }
+    }
+    return min;
+}
+
+int ConnectFourSolver::Negamax(const Position& position, int alpha, int beta) const
+{
+    // The player to move never has an immediate win here: Solve handles it and non-losing moves leave the opponent none.
+    uint64_t next = NonLosingMoves(position);
+    if (next == 0)
+    {
+        return -(m_rows * m_cols - position.Moves) / 2;
+    }
+    if (position.Moves >= m_rows * m_cols - 2)
+    {
+        return 0;
+    }
+
+    int score;
+    if (position.Moves <= m_databaseMaxMoves && ProbeDatabase(position, score))
+    {
+        return score;
+    }
+
+    int min = -(m_rows * m_cols - 2 - position.Moves) / 2;
+    if (alpha < min)
+    {
+        alpha = min;
+        if (alpha >= beta)
+        {
+            return alpha;
+        }
+    }
+
+    int max = (m_rows * m_cols - 1 - position.Moves) / 2;
+    uint64_t key = Key(position);
+    int bound;
+    if (ProbeTable(key, bound))
+    {
+        if (bound > m_maxScore - m_minScore + 1)
+        {
+            min = bound + 2 * m_minScore - m_maxScore - 2;
+            if (alpha < min)
+            {
+                alpha = min;
+                if (alpha >= beta)
+                {
+                    return alpha;
+                }
+            }
+        }
+        else
+        {
+            max = bound + m_minScore - 1;
+        }
+    }
+    if (beta > max)
+    {
+        beta = max;
+        if (alpha >= beta)
+        {
+            return beta;
+        }
+    }
+
+    // Moves creating the most new threats first, the center breaking ties.
+    uint64_t moves[m_cols];
+    int moveScores[m_cols];
+    int count = 0;
+    for (int i = m_cols - 1; i >= 0; --i)
+    {
+        uint64_t move = next & ColumnMask(ColumnOrder[i]);
+        if (!move)
+        {
+            continue;
+        }
+        int moveScore = PopCount(WinningCells(position.Current | move, position.Mask));
+        int slot = count++;
+        for (; slot > 0 && moveScores[slot - 1] > moveScore; --slot)
+        {
+            moves[slot] = moves[slot - 1];
+            moveScores[slot] = moveScores[slot - 1];
+        }
+        moves[slot] = move;
+        moveScores[slot] = moveScore;
+    }
+
+    for (int i = count - 1; i >= 0; --i)
+    {
+        int result = -Negamax(Play(position, moves[i]), -beta, -alpha);
+        if (result >= beta)
+        {
+            StoreTable(key, result + m_maxScore - 2 * m_minScore + 2);
+            return result;
+        }
+        if (result > alpha)
+        {
+            alpha = result;
+        }
+    }
+
+    StoreTable(key, alpha - m_minScore + 1);
+    return alpha;
+}
+
+bool ConnectFourSolver::ProbeTable(uint64_t key, int& bound) const
+{
+    uint64_t entry = m_table[(key * 0x9E3779B97F4A7C15ull) >> (64 - m_tableBits)].load(std::memory_order_relaxed);
+    if ((entry >> 8) != key || (entry & 0xFF) == 0)
+    {
+        return false;
+    }
+    bound = static_cast<int>(entry & 0xFF);
+    return true;
+}
+
+void ConnectFourSolver::StoreTable(uint64_t key, int bound) const
+{
+    m_table[(key * 0x9E3779B97F4A7C15ull) >> (64 - m_tableBits)].store((key << 8) | static_cast<uint64_t>(bound), std::memory_order_relaxed);
+}
+
+bool ConnectFourSolver::ProbeDatabase(const Position& position, int& score) const
+{
+    if (position.Moves > m_databaseMaxMoves)
+    {
+        return false;
+    }
+
+    uint64_t key = CanonicalKey(position);
+    const uint64_t* end = m_databaseKeys + m_databaseCount;
+    const uint64_t* found = std::lower_bound(m_databaseKeys, end, key);
+    if (found == end || *found != key)
+    {
+        return false;
+    }
+    score = m_databaseScores[found - m_databaseKeys];
+    return true;
+}
+
+bool ConnectFourSolver::BuildDatabase(const std::string& path, int size)
+{
+    // Every position reachable in at most size moves without a finished game, each mirrored pair once.
+    std::vector<Position> positions;
+    std::unordered_set<uint64_t> seen;
+    std::vector<Position> stack = { Position{ 0, 0, 0 } };
+    while (!stack.empty())
+    {
+        Position position = stack.back();
+        stack.pop_back();
+        if (!seen.insert(CanonicalKey(position)).second)
+        {
+            continue;
+        }
+        positions.push_back(position);
+        if (position.Moves == size)
+        {
+            continue;
+        }
+
+        uint64_t possible = PossibleMoves(position);
+        uint64_t winning = WinningCells(position.Current, position.Mask);
+        for (int column = 0; column < m_cols; ++column)
+        {
+            uint64_t move = possible & ColumnMask(column);
+            if (move && !(move & winning))
+            {
+                stack.push_back(Play(position, move));
+            }
+        }
+    }
+
+    std::vector<std::pair<uint64_t, int8_t>> entries;
+    entries.reserve(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        entries.push_back({ CanonicalKey(positions[i]), static_cast<int8_t>(Solve(positions[i])) });
+        if ((i + 1) % 1000 == 0)
+        {
+            std::cout << "Solved " << i + 1 << " of " << positions.size() << " positions\n";
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+
+    {
+        std::ofstream out(path, std::ios::binary);
+        if (!out)
+        {
+            return false;
+        }
+
+        DatabaseHeader header = {};
+        std::memcpy(header.Magic, DatabaseMagic, sizeof(header.Magic));
+        header.MaxMoves = static_cast<uint32_t>(size);
+        header.Count = entries.size();
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& entry : entries)
+        {
+            out.write(reinterpret_cast<const char*>(&entry.first), sizeof(entry.first));
+        }
+        for (const auto& entry : entries)
+        {
+            out.write(reinterpret_cast<const char*>(&entry.second), sizeof(entry.second));
+        }
+        if (!out)
+        {
+            return false;
+        }
+    }
+    return LoadDatabase(path);
+}
+
+bool ConnectFourSolver::LoadDatabase(const std::string& path)
+{
+    m_databaseKeys = nullptr;
+    m_databaseScores = nullptr;
+    m_databaseCount = 0;
+    m_databaseMaxMoves = -1;
+    if (!m_database.Open(path) || m_database.Size() < sizeof(DatabaseHeader))
+    {
+        m_database.Close();
+        return false;
+    }
+
+    const DatabaseHeader* header = static_cast<const DatabaseHeader*>(m_database.Data());
+    if (std::memcmp(header->Magic, DatabaseMagic, sizeof(header->Magic)) != 0
+        || m_database.Size() != sizeof(DatabaseHeader) + header->Count * (sizeof(uint64_t) + sizeof(int8_t)))
+    {
+        m_database.Close();
+        return false;
+    }
+
+    m_databaseKeys = reinterpret_cast<const uint64_t*>(header + 1);
+    m_databaseScores = reinterpret_cast<const int8_t*>(m_databaseKeys + header->Count);
+    m_databaseCount = header->Count;
+    m_databaseMaxMoves = static_cast<int>(header->MaxMoves);
+    return true;
+}
+
+uint64_t ConnectFourSolver::Key(const Position& position)
+{
+    // Unique per position: adding the mask sets the bit above each column's stones and keeps the current player's ones.
+    return position.Current + position.Mask;
+}
+
+uint64_t ConnectFourSolver::CanonicalKey(const Position& position)
+{
+    // The sum stays within each column, so mirroring the key mirrors the position.
+    uint64_t key = Key(position);
+    uint64_t mirrored = 0;
+    for (int column = 0; column < m_cols; ++column)
+    {
+        mirrored |= ((key >> (column * m_columnBits)) & ((1ull << m_columnBits) - 1)) << ((m_cols - 1 - column) * m_columnBits);
+    }
+    return std::min(key, mirrored);
+}
+
+ConnectFourSolver::Position ConnectFourSolver::Play(const Position& position, uint64_t move)
+{
+    return { position.Current ^ position.Mask, position.Mask | move, position.Moves + 1 };
+}
+
+uint64_t ConnectFourSolver::PossibleMoves(const Position& position)
+{
+    return (position.Mask + m_bottomMask) & m_boardMask;
+}
+
+uint64_t ConnectFourSolver::NonLosingMoves(const Position& position)
+{
+    uint64_t possible = PossibleMoves(position);
+    uint64_t opponentWins = WinningCells(position.Current ^ position.Mask, position.Mask);
+    uint64_t forced = possible & opponentWins;
+    if (forced)
+    {
+        if (forced & (forced - 1))
+        {
+            return 0;
+        }
+        possible = forced;
+    }
+    return possible & ~(opponentWins >> 1);
+}
+
+uint64_t ConnectFourSolver::WinningCells(uint64_t stones, uint64_t mask)
+{
+    // Vertical, then for each of the three other directions the cells with three stones in line on either side of them.
+    uint64_t cells = (stones << 1) & (stones << 2) & (stones << 3);
+    const int shifts[3] = { m_columnBits, m_columnBits - 1, m_columnBits + 1 };
+    for (int shift : shifts)
+    {
+        uint64_t pair = (stones << shift) & (stones << 2 * shift);
+        cells |= pair & (stones << 3 * shift);
+        cells |= pair & (stones >> shift);
+        pair = (stones >> shift) & (stones >> 2 * shift);
+        cells |= pair & (stones << shift);
+        cells |= pair & (stones >> 3 * shift);
+    }
+    return cells & (m_boardMask ^ mask);
+}
+
+bool ConnectFourSolver::CanWinNext(const Position& position)
+{
+    return (WinningCells(position.Current, position.Mask) & PossibleMoves(position)) != 0;
+}
+
+uint64_t ConnectFourSolver::ColumnMask(int column)
+{
+    return ((1ull << m_rows) - 1) << (column * m_columnBits);
+}
+
+int ConnectFourSolver::PopCount(uint64_t bits)
+{
+    bits = bits - ((bits >> 1) & 0x5555555555555555ull);
+    bits = (bits & 0x3333333333333333ull) + ((bits >> 2) & 0x3333333333333333ull);
+    bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return static_cast<int>((bits * 0x0101010101010101ull) >> 56);
+}
\ No newline at end of file
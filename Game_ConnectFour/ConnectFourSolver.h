@@ -0,0 +1,96 @@
+#pragma once
+#include "IGame.h"
+#include "ConnectFour.h"
+#include "../Trainer/Public/GameOracle.h"
+#include "../Trainer/Public/MappedFile.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#ifdef _WIN32
+#define IGAME_API __declspec(dllexport)
+#else
+#define IGAME_API __attribute__((visibility("default")))
+#endif
+
+/// <summary>
+/// Exact Connect Four solver: negamax with alpha-beta on bitboards in the ConnectFour layout, moves ordered by the threats
+/// they create and a transposition table shared by all threads. A database of solved openings, mapped from a file,
+/// answers the early positions the search would take long on.
+/// </summary>
+class IGAME_API ConnectFourSolver final : public GameOracle {
+public:
+    /// <summary>A position as seen by the player to move.</summary>
+    struct Position {
+        /// <summary>Stones of the player to move.</summary>
+        uint64_t Current;
+        /// <summary>All stones.</summary>
+        uint64_t Mask;
+        int Moves;
+    };
+
+    ConnectFourSolver(size_t tableBytes = 64 * 1024 * 1024);
+
+    bool Probe(const IGame& state, float& value) const;
+    int BestMove(const IGame& state) const;
+    /// <summary>Probe solves positions with at most this many empty cells when the database doesn't hold them.</summary>
+    void SetProbeLimit(int limit);
+    int GetProbeLimit() const;
+    /// <summary>Solves every position up to the given number of moves, mirrored positions once, and maps the written file.</summary>
+    bool BuildDatabase(const std::string& path, int size);
+    bool LoadDatabase(const std::string& path);
+
+    static Position FromGame(const ConnectFour& game);
+    /// <summary>
+    /// Score of the position for the player to move with perfect play: positive when they win, by the number of their stones
+    /// still unplayed after the winning one plus one, negative when they lose and 0 for a draw.
+    /// </summary>
+    int Solve(const Position& position) const;
+
+private:
+    static const int m_rows = 6;
+    static const int m_cols = 7;
+    static const int m_columnBits = m_rows + 1;
+    static const int m_minScore = -(m_rows * m_cols) / 2 + 3;
+    static const int m_maxScore = (m_rows * m_cols + 1) / 2 - 3;
+    static const uint64_t m_bottomMask = 0x0040810204081ull;
+    static const uint64_t m_boardMask = m_bottomMask * ((1ull << m_rows) - 1);
+
+    struct DatabaseHeader {
+        char Magic[8];
+        uint32_t MaxMoves;
+        uint32_t Reserved;
+        uint64_t Count;
+    };
+
+    /// <summary>Entries pack the position key above an 8-bit bound, so a whole entry is read and written at once.</summary>
+    std::unique_ptr<std::atomic<uint64_t>[]> m_table;
+    int m_tableBits;
+    int m_probeLimit = 12;
+
+    MappedFile m_database;
+    /// <summary>Sorted keys of the database positions, followed by one score per key.</summary>
+    const uint64_t* m_databaseKeys = nullptr;
+    const int8_t* m_databaseScores = nullptr;
+    uint64_t m_databaseCount = 0;
+    int m_databaseMaxMoves = -1;
+
+    int Negamax(const Position& position, int alpha, int beta) const;
+    bool ProbeDatabase(const Position& position, int& score) const;
+    bool ProbeTable(uint64_t key, int& bound) const;
+    void StoreTable(uint64_t key, int bound) const;
+
+    static uint64_t Key(const Position& position);
+    /// <summary>The smaller key of the position and its mirror image.</summary>
+    static uint64_t CanonicalKey(const Position& position);
+    static Position Play(const Position& position, uint64_t move);
+    static uint64_t PossibleMoves(const Position& position);
+    /// <summary>Moves that neither leave an immediate win to the opponent nor ignore one they already have.</summary>
+    static uint64_t NonLosingMoves(const Position& position);
+    /// <summary>Empty cells that would complete four for the stones, reachable or not.</summary>
+    static uint64_t WinningCells(uint64_t stones, uint64_t mask);
+    static bool CanWinNext(const Position& position);
+    static uint64_t ColumnMask(int column);
+    static int PopCount(uint64_t bits);
+};
\ No newline at end of file
@@ -1,10 +1,25 @@
 #include "pch.h"
 #include "ConnectFour.h"
+#include "ConnectFourSolver.h"
+#include "ConnectFourBatchEnv.h"
+#include "../Trainer/Public/SimulationEngine.h"
 
-extern "C" __declspec(dllexport) const char* GetGameName() {
+extern "C" IGAME_API const char* GetGameName() {
     return "Connect Four";
 }
 
-extern "C" __declspec(dllexport) IGame * CreateGame() {
+extern "C" IGAME_API IGame * CreateGame() {
     return new ConnectFour();
+}
+
+extern "C" IGAME_API SimulationEngine * CreateSimulationEngine() {
+    return new GameSimulationEngine<ConnectFour>();
+}
+
+extern "C" IGAME_API GameOracle * CreateGameOracle() {
+    return new ConnectFourSolver();
+}
+
+extern "C" IGAME_API BatchEnvironment * CreateBatchEnvironment(int games) {
+    return new ConnectFourBatchEnv(games);
 }
\ No newline at end of file
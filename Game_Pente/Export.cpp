@@ -1,10 +1,15 @@
 #include "pch.h"
 #include "Pente.h"
+#include "../Trainer/Public/SimulationEngine.h"
 
-extern "C" __declspec(dllexport) const char* GetGameName() {
+extern "C" IGAME_API const char* GetGameName() {
     return "Pente";
 }
 
-extern "C" __declspec(dllexport) IGame * CreateGame() {
+extern "C" IGAME_API IGame * CreateGame() {
     return new Pente();
+}
+
+extern "C" IGAME_API SimulationEngine * CreateSimulationEngine() {
+    return new GameSimulationEngine<Pente>();
 }
\ No newline at end of file
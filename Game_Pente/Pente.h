@@ -1,13 +1,20 @@
 #pragma once
 #include "IGame.h"
 #include <vector>
+#include <cstdint>
 
+#ifdef _WIN32
 #define IGAME_API __declspec(dllexport)
+#else
+#define IGAME_API __attribute__((visibility("default")))
+#endif
 
-class IGAME_API Pente : public IGame {
+class IGAME_API Pente final : public IGame {
 public:
     Pente();
-    Pente(const Pente& other);
+    /// <summary>The state is fixed-size arrays and scalars only, so copies are flat and keep the undo history and captures.</summary>
+    Pente(const Pente&) = default;
+    Pente& operator=(const Pente&) = default;
     std::unordered_map<int, std::string> GetSpritePaths() const;
     std::vector<std::vector<int>> GetSpriteGrid() const;
     bool InterpretAndMakeMove(const std::string& moveStr);
@@ -16,31 +23,66 @@ public:
     bool MakeMove(int column);
     bool UnMakeMove();
     Winner GetWinner() const;
-    std::vector<int> GetValidMoves() const;
+    int GenerateMoves(MoveList& moves) const;
     int GetCurrentPlayer() const;
+    uint64_t GetHash() const;
+    int SymmetryCount() const;
+    uint64_t GetSymmetricHash(int transform) const;
+    int TransformMove(int move, int transform) const;
+    int InverseTransform(int transform) const;
+    bool SwapsPlayers(int transform) const;
+    void EncodeSymmetricState(float* state, int transform) const;
 
     void PrintBoard() const;
 
     std::unique_ptr<IGame> Clone() const;
-    std::vector<float> GetBoardState() const;
+    void CopyFrom(const IGame& other);
+    int StateSize() const;
+    void EncodeState(float* state) const;
 
     std::string GetName() const;
 
     ~Pente();
 
 private:
-    struct Coordinates {
-        int x = 0;
-        int y = 0;
+    /// <summary>Stone placed by a move and the directions in which it captured, bit i for direction i.</summary>
+    struct MoveRecord {
+        int16_t cell;
+        uint8_t captureDirections;
     };
-    int m_boardSize = 19;
-    std::vector<std::vector<int>> m_board; // 0 = empty, 1 = player 1, 2 = player 2
+
+    static const int m_boardSize = 19;
+    /// <summary>The board is stored with a one cell wall around it, so scans stop at the edge without bounds checks.</summary>
+    static const int m_paddedSize = m_boardSize + 2;
+    static const int8_t m_wall = 3;
+    /// <summary>Longer than any game that ends with its result; older records are overwritten after that.</summary>
+    static const int m_historyCapacity = 512;
+
+    int8_t m_cells[m_paddedSize * m_paddedSize]; // 0 = empty, 1 = player 1, 2 = player 2, 3 = wall
+    int m_emptyCells;
     int m_currentPlayer;
     Winner m_winner;
-    std::vector<std::vector<Coordinates>> m_moveHistory;
+    MoveRecord m_moveHistory[m_historyCapacity]; // ring buffer ending before m_historyEnd
+    int m_historyEnd = 0;
+    int m_historyCount = 0;
     int m_takesForFirst = 0;
     int m_takesForSecond = 0;
+    /// <summary>Stones within the frontier distance of each cell, by board index y * 19 + x.</summary>
+    uint8_t m_nearbyStones[m_boardSize * m_boardSize];
+    /// <summary>Empty cells with a stone nearby, one bit per board index. These are the moves offered to the search.</summary>
+    uint64_t m_frontier[(m_boardSize * m_boardSize + 63) / 64];
+    uint64_t m_hash;
 
     bool CheckIfMoveLegal(int x, int y);
     bool CheckIfBoardFull();
+    /// <summary>Index of a board coordinate in the padded board.</summary>
+    static int CellIndex(int x, int y);
+    int GetCell(int x, int y) const;
+    static int BoardIndex(int paddedCell);
+    /// <summary>Frontier upkeep after the cell at the board index got a stone. The cell has to be written already.</summary>
+    void OnStonePlaced(int boardIndex);
+    /// <summary>Frontier upkeep after the stone at the board index was taken off. The cell has to be cleared already.</summary>
+    void OnStoneRemoved(int boardIndex);
+    /// <summary>The position hash built from scratch, to check the incremental one, or of the position mapped through a symmetry.</summary>
+    uint64_t ComputeHash(int transform = 0) const;
 };
\ No newline at end of file
@@ -0,0 +1,640 @@
+#include "Benchmark.h"
+#include "Random.h"
+#include "MonteCarlo.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+namespace
+{
+	/// <summary>Fingerprint of an encoded board and the side to move, independent of the game's own hash.</summary>
+	uint64_t Fingerprint(int player, const std::vector<float>& state)
+	{
+		uint64_t fingerprint = Random::Mix(static_cast<uint64_t>(player));
+		for (float value : state)
+		{
+			uint32_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			fingerprint = Random::Mix(fingerprint ^ bits);
+		}
+		return fingerprint;
+	}
+
+	uint64_t BoardFingerprint(const IGame& game)
+	{
+		return Fingerprint(game.GetCurrentPlayer(), game.GetBoardState());
+	}
+
+	bool SamePosition(const IGame& game, const IGame& snapshot)
+	{
+		if (game.GetHash() != snapshot.GetHash() || game.GetCurrentPlayer() != snapshot.GetCurrentPlayer()
+			|| game.GetWinner() != snapshot.GetWinner() || game.GetBoardState() != snapshot.GetBoardState())
+		{
+			return false;
+		}
+
+		MoveList moves;
+		MoveList snapshotMoves;
+		game.GenerateMoves(moves);
+		snapshot.GenerateMoves(snapshotMoves);
+		return std::equal(moves.begin(), moves.end(), snapshotMoves.begin(), snapshotMoves.end());
+	}
+
+	double SecondsSince(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	/// <summary>Raw text of a value in one of the suite's JSON lines, without the quotes of strings.</summary>
+	std::string JsonValue(const std::string& line, const std::string& key)
+	{
+		std::string pattern = "\"" + key + "\":";
+		size_t start = line.find(pattern);
+		if (start == std::string::npos)
+		{
+			return "";
+		}
+		start += pattern.size();
+		if (start < line.size() && line[start] == '"')
+		{
+			size_t end = line.find('"', start + 1);
+			return end == std::string::npos ? "" : line.substr(start + 1, end - start - 1);
+		}
+		size_t end = line.find_first_of(",}", start);
+		return end == std::string::npos ? "" : line.substr(start, end - start);
+	}
+}
+
+Benchmark::PerftResult Benchmark::Perft(IGame& game, int depth, const SimulationEngine* engine)
+{
+	PerftResult result;
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	if (engine)
+	{
+		engine->Perft(game, depth, result.LeafNodes, result.MovesMade);
+	}
+	else
+	{
+		PerftRecursive(game, depth, result);
+	}
+	result.Seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	return result;
+}
+
+void Benchmark::PerftRecursive(IGame& game, int depth, PerftResult& result)
+{
+	if (depth == 0)
+	{
+		result.LeafNodes++;
+		return;
+	}
+
+	MoveList moves;
+	game.GenerateMoves(moves);
+	for (int move : moves)
+	{
+		game.MakeMove(move);
+		result.MovesMade++;
+		PerftRecursive(game, depth - 1, result);
+		game.UnMakeMove();
+	}
+}
+
+void Benchmark::RunPerft(const IGame& game, int maxDepth, const SimulationEngine* engine)
+{
+	std::unique_ptr<IGame> board = game.Clone();
+	std::cout << "Perft for " << board->GetName() << "\n";
+	for (int depth = 1; depth <= maxDepth; ++depth)
+	{
+		PerftResult result = Perft(*board, depth);
+		double movesPerSecond = result.Seconds > 0.0 ? result.MovesMade / result.Seconds : 0.0;
+		std::cout << "Depth " << depth << ": " << result.LeafNodes << " leaves, " << result.MovesMade << " moves in "
+			<< result.Seconds << " s (" << static_cast<long long>(movesPerSecond) << " moves/s)\n";
+
+		if (engine)
+		{
+			PerftResult engineResult = Perft(*board, depth, engine);
+			double engineMovesPerSecond = engineResult.Seconds > 0.0 ? engineResult.MovesMade / engineResult.Seconds : 0.0;
+			std::cout << "  engine: " << engineResult.LeafNodes << " leaves in " << engineResult.Seconds << " s ("
+				<< static_cast<long long>(engineMovesPerSecond) << " moves/s)\n";
+		}
+	}
+}
+
+void Benchmark::RunSearchComparison(const IGame& game, const SimulationEngine& engine, int iterations)
+{
+	std::unique_ptr<IGame> board = game.Clone();
+	SearchSettings settings;
+	settings.Seed = Random::NextTaskSeed(RandomDomain::Search);
+	settings.Deterministic = true;
+
+	RandomPlayoutEvaluator throughInterface;
+	RandomPlayoutEvaluator throughEngine(1, 400, &engine);
+	MonteCarlo::EvaluationAndMove virtualResult = MonteCarlo::MonteCarloTreeSearch(*board, iterations, throughInterface, settings);
+	settings.Engine = &engine;
+	MonteCarlo::EvaluationAndMove engineResult = MonteCarlo::MonteCarloTreeSearch(*board, iterations, throughEngine, settings);
+
+	std::cout << "Playout search for " << board->GetName() << ", " << iterations << " iterations\n";
+	std::cout << "  IGame:  " << static_cast<long long>(virtualResult.Stats.IterationsPerSecond()) << " it/s, move " << virtualResult.Move << "\n";
+	std::cout << "  engine: " << static_cast<long long>(engineResult.Stats.IterationsPerSecond()) << " it/s, move " << engineResult.Move << "\n";
+}
+
+Benchmark::HashCheckResult Benchmark::CheckHashes(IGame& game, int games, std::mt19937& rng)
+{
+	const int maxMoves = 400;
+	HashCheckResult result;
+	std::unordered_map<uint64_t, uint64_t> fingerprints;
+	MoveList moves;
+	std::vector<float> symmetricState(game.StateSize());
+	std::vector<float> mirrorState(game.StateSize());
+
+	for (int g = 0; g < games; ++g)
+	{
+		uint64_t startHash = game.GetHash();
+		// mirrors[i] follows the game through the transform transforms[i].
+		std::vector<int> transforms;
+		std::vector<std::unique_ptr<IGame>> mirrors;
+		for (int transform = 1; transform < game.SymmetryCount(); ++transform)
+		{
+			if (!game.SwapsPlayers(transform) && game.GetSymmetricHash(transform) == startHash)
+			{
+				transforms.push_back(transform);
+				mirrors.push_back(game.Clone());
+			}
+		}
+
+		int movesMade = 0;
+		while (game.GetWinner() == IGame::Winner::OnGoing && movesMade < maxMoves)
+		{
+			int moveCount = game.GenerateMoves(moves);
+			if (moveCount == 0)
+			{
+				break;
+			}
+
+			uint64_t hash = game.GetHash();
+			uint64_t fingerprint = BoardFingerprint(game);
+			auto inserted = fingerprints.emplace(hash, fingerprint);
+			if (!inserted.second && inserted.first->second != fingerprint)
+			{
+				result.Collisions++;
+			}
+			result.Positions++;
+
+			IGame::CanonicalForm canonical = game.Canonicalize();
+			for (int transform = 1; transform < game.SymmetryCount(); ++transform)
+			{
+				uint64_t symmetricHash = game.GetSymmetricHash(transform);
+				if (symmetricHash < canonical.Hash)
+				{
+					result.SymmetryMismatches++;
+				}
+				if (game.SwapsPlayers(transform))
+				{
+					game.EncodeSymmetricState(symmetricState.data(), transform);
+					uint64_t symmetricFingerprint = Fingerprint(3 - game.GetCurrentPlayer(), symmetricState);
+					auto symmetric = fingerprints.emplace(symmetricHash, symmetricFingerprint);
+					if (!symmetric.second && symmetric.first->second != symmetricFingerprint)
+					{
+						result.SymmetryMismatches++;
+					}
+				}
+			}
+			for (size_t i = 0; i < mirrors.size(); ++i)
+			{
+				game.EncodeSymmetricState(symmetricState.data(), transforms[i]);
+				mirrors[i]->EncodeState(mirrorState.data());
+				if (game.GetSymmetricHash(transforms[i]) != mirrors[i]->GetHash() || symmetricState != mirrorState
+					|| mirrors[i]->Canonicalize().Hash != canonical.Hash)
+				{
+					result.SymmetryMismatches++;
+				}
+			}
+
+			int move = moves[std::uniform_int_distribution<int>(0, moveCount - 1)(rng)];
+			game.MakeMove(move);
+			uint64_t hashAfter = game.GetHash();
+			game.UnMakeMove();
+			if (game.GetHash() != hash)
+			{
+				result.Mismatches++;
+			}
+			game.MakeMove(move);
+			if (game.GetHash() != hashAfter)
+			{
+				result.Mismatches++;
+			}
+			for (size_t i = 0; i < mirrors.size(); ++i)
+			{
+				if (!mirrors[i]->MakeMove(game.TransformMove(move, transforms[i])))
+				{
+					result.SymmetryMismatches++;
+				}
+			}
+			++movesMade;
+		}
+
+		for (int i = 0; i < movesMade; ++i)
+		{
+			game.UnMakeMove();
+		}
+		if (game.GetHash() != startHash)
+		{
+			result.Mismatches++;
+		}
+	}
+	return result;
+}
+
+void Benchmark::RunHashCheck(const IGame& game, int games)
+{
+	std::unique_ptr<IGame> board = game.Clone();
+	std::mt19937 rng = Random::MakeGenerator(Random::NextTaskSeed(RandomDomain::Fuzzing));
+	HashCheckResult result = CheckHashes(*board, games, rng);
+	std::cout << "Hash check for " << board->GetName() << ": " << result.Positions << " positions, "
+		<< result.Mismatches << " mismatches, " << result.Collisions << " collisions, " << result.SymmetryMismatches << " symmetry mismatches\n";
+}
+
+Benchmark::UndoCheckResult Benchmark::CheckUndo(IGame& game, int games, std::mt19937& rng)
+{
+	const int maxMoves = 400;
+	UndoCheckResult result;
+	// snapshots[i] is the position before the move that made the game i + 1 moves long.
+	std::vector<std::unique_ptr<IGame>> snapshots;
+	MoveList moves;
+
+	auto undo = [&](int& movesMade)
+	{
+		game.UnMakeMove();
+		--movesMade;
+		result.Undos++;
+		if (!SamePosition(game, *snapshots[movesMade]))
+		{
+			result.Mismatches++;
+		}
+	};
+
+	for (int g = 0; g < games; ++g)
+	{
+		int movesMade = 0;
+		while (game.GetWinner() == IGame::Winner::OnGoing && movesMade < maxMoves)
+		{
+			if (movesMade > 0 && std::uniform_int_distribution<int>(0, 3)(rng) == 0)
+			{
+				undo(movesMade);
+				continue;
+			}
+
+			int moveCount = game.GenerateMoves(moves);
+			if (moveCount == 0)
+			{
+				break;
+			}
+			if (static_cast<int>(snapshots.size()) <= movesMade)
+			{
+				snapshots.push_back(game.Clone());
+			}
+			else
+			{
+				snapshots[movesMade]->CopyFrom(game);
+			}
+			game.MakeMove(moves[std::uniform_int_distribution<int>(0, moveCount - 1)(rng)]);
+			++movesMade;
+			result.Moves++;
+		}
+
+		while (movesMade > 0)
+		{
+			undo(movesMade);
+		}
+	}
+	return result;
+}
+
+void Benchmark::RunUndoCheck(const IGame& game, int games)
+{
+	std::unique_ptr<IGame> board = game.Clone();
+	std::mt19937 rng = Random::MakeGenerator(Random::NextTaskSeed(RandomDomain::Fuzzing));
+	UndoCheckResult result = CheckUndo(*board, games, rng);
+	std::cout << "Undo check for " << board->GetName() << ": " << result.Moves << " moves, " << result.Undos << " undos, "
+		<< result.Mismatches << " mismatches\n";
+}
+
+Benchmark::BatchCheckResult Benchmark::CheckBatchEnvironment(const IGame& game, BatchEnvironment& batch, int steps, std::mt19937& rng)
+{
+	BatchCheckResult result;
+	int size = batch.Size();
+	int stateSize = batch.StateSize();
+	std::vector<std::unique_ptr<IGame>> games;
+	for (int i = 0; i < size; ++i)
+	{
+		games.push_back(game.Clone());
+	}
+	std::vector<int> moves(size);
+	std::vector<int> winners(size);
+	std::vector<float> batchStates(static_cast<size_t>(size) * stateSize);
+	std::vector<float> gameState(game.StateSize());
+	batch.Reset();
+
+	for (int step = 0; step < steps; ++step)
+	{
+		batch.SampleRandomMoves(rng, moves.data());
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		int illegalMoves = batch.Step(moves.data(), winners.data());
+		result.BatchSeconds += SecondsSince(start);
+		result.Moves += size;
+		result.Mismatches += illegalMoves;
+
+		start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < size; ++i)
+		{
+			games[i]->MakeMove(moves[i]);
+			if (games[i]->GetWinner() != winners[i])
+			{
+				result.Mismatches++;
+			}
+			if (games[i]->GetWinner() != IGame::Winner::OnGoing)
+			{
+				games[i]->Reset();
+			}
+		}
+		result.GameSeconds += SecondsSince(start);
+
+		batch.EncodeStates(batchStates.data());
+		for (int i = 0; i < size; ++i)
+		{
+			games[i]->EncodeState(gameState.data());
+			if (stateSize != static_cast<int>(gameState.size())
+				|| !std::equal(gameState.begin(), gameState.end(), batchStates.begin() + static_cast<size_t>(i) * stateSize))
+			{
+				result.Mismatches++;
+			}
+		}
+	}
+	return result;
+}
+
+void Benchmark::RunOracleBenchmark(const IGame& game, const GameOracle& oracle, int games)
+{
+	std::unique_ptr<IGame> board = game.Clone();
+	std::mt19937 rng = Random::MakeGenerator(Random::NextTaskSeed(RandomDomain::Fuzzing));
+	long long positions = 0;
+	long long reached = 0;
+	double probeSeconds = 0.0;
+	double bestMoveSeconds = 0.0;
+	MoveList moves;
+	for (int i = 0; i < games; ++i)
+	{
+		board->Reset();
+		while (board->GetWinner() == IGame::Winner::OnGoing)
+		{
+			float value;
+			auto start = std::chrono::high_resolution_clock::now();
+			bool found = oracle.Probe(*board, value);
+			probeSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			positions++;
+			if (found)
+			{
+				reached++;
+				start = std::chrono::high_resolution_clock::now();
+				oracle.BestMove(*board);
+				bestMoveSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+			}
+
+			int moveCount = board->GenerateMoves(moves);
+			if (moveCount == 0)
+			{
+				break;
+			}
+			board->MakeMove(moves[std::uniform_int_distribution<int>(0, moveCount - 1)(rng)]);
+		}
+	}
+
+	std::cout << "Oracle probes for " << board->GetName() << ": " << positions << " positions, " << reached << " reached, "
+		<< (positions > 0 ? probeSeconds * 1e9 / positions : 0.0) << " ns per probe, "
+		<< (reached > 0 ? bestMoveSeconds * 1e9 / reached : 0.0) << " ns per best move\n";
+}
+
+std::vector<std::unique_ptr<IGame>> Benchmark::MidGamePositions(const IGame& game)
+{
+	// The moves are picked with raw mt19937 output, which the standard fixes, so the positions and their perft counts
+	// don't depend on the library's distributions.
+	const int plies[] = { 8, 16, 24 };
+	std::vector<std::unique_ptr<IGame>> positions;
+	MoveList moves;
+	for (int i = 0; i < 3; ++i)
+	{
+		std::mt19937 rng(12345 + i);
+		std::unique_ptr<IGame> position = game.Clone();
+		for (int ply = 0; ply < plies[i] && position->GetWinner() == IGame::Winner::OnGoing; ++ply)
+		{
+			int moveCount = position->GenerateMoves(moves);
+			if (moveCount == 0)
+			{
+				break;
+			}
+			position->MakeMove(moves[rng() % moveCount]);
+		}
+		positions.push_back(std::move(position));
+	}
+	return positions;
+}
+
+std::vector<Benchmark::SuiteResult> Benchmark::RunGameSuite(const IGame& game, const SimulationEngine* engine, const SuiteSettings& settings)
+{
+	std::vector<SuiteResult> results;
+	std::string name = game.GetName();
+
+	std::vector<std::unique_ptr<IGame>> positions;
+	positions.push_back(game.Clone());
+	for (std::unique_ptr<IGame>& position : MidGamePositions(game))
+	{
+		positions.push_back(std::move(position));
+	}
+
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		std::string positionName = i == 0 ? "start" : "mid" + std::to_string(i);
+		long long previousLeaves = 1;
+		for (int depth = 1; depth <= settings.MaxPerftDepth; ++depth)
+		{
+			PerftResult perft = Perft(*positions[i], depth, engine);
+			SuiteResult result;
+			result.Game = name;
+			result.Test = "perft_" + positionName + "_d" + std::to_string(depth);
+			result.Count = perft.LeafNodes;
+			result.ExactCount = true;
+			result.Seconds = perft.Seconds;
+			result.Rate = perft.Seconds > 0.0 ? perft.MovesMade / perft.Seconds : 0.0;
+			results.push_back(result);
+
+			// The next depth costs about one branching factor more.
+			double branching = previousLeaves > 0 ? static_cast<double>(perft.LeafNodes) / previousLeaves : 0.0;
+			if (perft.LeafNodes == 0 || perft.Seconds * branching > settings.PerftSeconds)
+			{
+				break;
+			}
+			previousLeaves = perft.LeafNodes;
+		}
+	}
+
+	{
+		const int playoutsPerCall = 16;
+		const int maxPlayoutMoves = 400;
+		std::unique_ptr<IGame> board = game.Clone();
+		std::mt19937 rng(12345);
+		MoveList moves;
+		SuiteResult result;
+		result.Game = name;
+		result.Test = "random_games";
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		do
+		{
+			if (engine)
+			{
+				engine->RandomPlayouts(*board, rng, playoutsPerCall, maxPlayoutMoves, nullptr);
+				result.Count += playoutsPerCall;
+				continue;
+			}
+
+			int movesMade = 0;
+			while (board->GetWinner() == IGame::Winner::OnGoing && movesMade < maxPlayoutMoves)
+			{
+				int moveCount = board->GenerateMoves(moves);
+				if (moveCount == 0)
+				{
+					break;
+				}
+				board->MakeMove(moves[rng() % moveCount]);
+				++movesMade;
+			}
+			for (int i = 0; i < movesMade; ++i)
+			{
+				board->UnMakeMove();
+			}
+			result.Count++;
+		} while (SecondsSince(start) < settings.ThroughputSeconds);
+		result.Seconds = SecondsSince(start);
+		result.Rate = result.Count / result.Seconds;
+		results.push_back(result);
+	}
+
+	{
+		const int encodesPerCheck = 1024;
+		std::vector<float> buffer(game.StateSize());
+		SuiteResult encode;
+		encode.Game = name;
+		encode.Test = "encode_state";
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		do
+		{
+			for (int i = 0; i < encodesPerCheck; ++i)
+			{
+				positions[i % positions.size()]->EncodeState(buffer.data());
+			}
+			encode.Count += encodesPerCheck;
+		} while (SecondsSince(start) < settings.ThroughputSeconds);
+		encode.Seconds = SecondsSince(start);
+		encode.Rate = encode.Count / encode.Seconds;
+		results.push_back(encode);
+
+		SuiteResult boardState;
+		boardState.Game = name;
+		boardState.Test = "get_board_state";
+		start = std::chrono::high_resolution_clock::now();
+		do
+		{
+			for (int i = 0; i < encodesPerCheck; ++i)
+			{
+				buffer = positions[i % positions.size()]->GetBoardState();
+			}
+			boardState.Count += encodesPerCheck;
+		} while (SecondsSince(start) < settings.ThroughputSeconds);
+		boardState.Seconds = SecondsSince(start);
+		boardState.Rate = boardState.Count / boardState.Seconds;
+		results.push_back(boardState);
+	}
+
+	return results;
+}
+
+bool Benchmark::WriteSuiteResults(const std::string& path, const std::vector<SuiteResult>& results)
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		return false;
+	}
+
+	for (const SuiteResult& result : results)
+	{
+		file << "{\"build\":\"" << __DATE__ << " " << __TIME__ << "\""
+			<< ",\"game\":\"" << result.Game << "\""
+			<< ",\"test\":\"" << result.Test << "\""
+			<< ",\"count\":" << result.Count
+			<< ",\"exact\":" << (result.ExactCount ? "true" : "false")
+			<< ",\"seconds\":" << result.Seconds
+			<< ",\"rate\":" << result.Rate
+			<< "}\n";
+	}
+	return static_cast<bool>(file);
+}
+
+std::vector<Benchmark::SuiteResult> Benchmark::ReadSuiteResults(const std::string& path)
+{
+	std::vector<SuiteResult> results;
+	std::ifstream file(path);
+	std::string line;
+	while (std::getline(file, line))
+	{
+		SuiteResult result;
+		result.Game = JsonValue(line, "game");
+		result.Test = JsonValue(line, "test");
+		if (result.Game.empty() || result.Test.empty())
+		{
+			continue;
+		}
+		result.Count = std::atoll(JsonValue(line, "count").c_str());
+		result.ExactCount = JsonValue(line, "exact") == "true";
+		result.Seconds = std::atof(JsonValue(line, "seconds").c_str());
+		result.Rate = std::atof(JsonValue(line, "rate").c_str());
+		results.push_back(result);
+	}
+	return results;
+}
+
+int Benchmark::CompareToBaseline(const std::vector<SuiteResult>& results, const std::vector<SuiteResult>& baseline)
+{
+	int mismatches = 0;
+	for (const SuiteResult& result : results)
+	{
+		const SuiteResult* previous = nullptr;
+		for (const SuiteResult& candidate : baseline)
+		{
+			if (candidate.Game == result.Game && candidate.Test == result.Test)
+			{
+				previous = &candidate;
+				break;
+			}
+		}
+		if (!previous)
+		{
+			continue;
+		}
+
+		double change = previous->Rate > 0.0 ? (result.Rate / previous->Rate - 1.0) * 100.0 : 0.0;
+		std::cout << result.Game << " " << result.Test << ": " << static_cast<long long>(result.Rate) << "/s, baseline "
+			<< static_cast<long long>(previous->Rate) << "/s (" << (change >= 0.0 ? "+" : "") << change << "%)";
+		if (result.ExactCount && previous->ExactCount && result.Count != previous->Count)
+		{
+			std::cout << " COUNT MISMATCH: " << result.Count << " instead of " << previous->Count;
+			mismatches++;
+		}
+		std::cout << "\n";
+	}
+	return mismatches;
+}
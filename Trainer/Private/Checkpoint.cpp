@@ -0,0 +1,75 @@
+#include "Checkpoint.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+Checkpoint::~Checkpoint()
+{
+	Wait();
+}
+
+void Checkpoint::WriteString(std::ostream& out, const std::string& value)
+{
+	Write(out, static_cast<uint64_t>(value.size()));
+	out.write(value.data(), value.size());
+}
+
+void Checkpoint::ReadString(std::istream& in, std::string& value)
+{
+	uint64_t size = 0;
+	Read(in, size);
+	value.clear();
+	// Grows with the data actually read, so a damaged size fails on the short read instead of allocating it.
+	char buffer[4096];
+	while (in && size > 0)
+	{
+		size_t chunk = static_cast<size_t>(std::min<uint64_t>(size, sizeof(buffer)));
+		in.read(buffer, chunk);
+		value.append(buffer, static_cast<size_t>(in.gcount()));
+		size -= chunk;
+	}
+}
+
+void Checkpoint::SaveAsync(const std::string& path, std::string bytes)
+{
+	Wait();
+	m_writer = std::thread([this, path, bytes = std::move(bytes)]()
+	{
+		std::string temporaryPath = path + ".tmp";
+		{
+			std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+			out.write(bytes.data(), bytes.size());
+			out.flush();
+			if (!out)
+			{
+				m_lastSaved = false;
+				return;
+			}
+		}
+		std::error_code error;
+		std::filesystem::rename(temporaryPath, path, error);
+		m_lastSaved = !error;
+	});
+}
+
+bool Checkpoint::Wait()
+{
+	if (m_writer.joinable())
+	{
+		m_writer.join();
+	}
+	return m_lastSaved;
+}
+
+bool Checkpoint::Load(const std::string& path, std::string& bytes)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+	{
+		return false;
+	}
+	bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	return !in.bad();
+}
@@ -0,0 +1,132 @@
+#include "EvaluationCache.h"
+#include "Random.h"
+#include <cstring>
+#include <vector>
+
+EvaluationCache::EvaluationCache(size_t bytes) : m_hits(0), m_misses(0)
+{
+	Resize(bytes);
+}
+
+void EvaluationCache::Resize(size_t bytes)
+{
+	// A power of two bucket count lets the key's low bits pick the bucket.
+	size_t buckets = 1;
+	while (buckets * 2 * sizeof(Bucket) <= bytes)
+	{
+		buckets *= 2;
+	}
+	m_buckets.reset(new Bucket[buckets]);
+	m_bucketCount = buckets;
+	Clear();
+}
+
+void EvaluationCache::Clear()
+{
+	for (size_t i = 0; i < m_bucketCount; ++i)
+	{
+		for (Entry& entry : m_buckets[i].Entries)
+		{
+			entry.Check.store(0, std::memory_order_relaxed);
+			entry.Data.store(0, std::memory_order_relaxed);
+		}
+	}
+	ResetStats();
+}
+
+float EvaluationCache::Evaluate(const NeuralNetwork& network, const IGame& state)
+{
+	uint64_t key = Key(state.GetHash(), network);
+	float rawEvaluation;
+	if (Probe(key, rawEvaluation))
+	{
+		return rawEvaluation;
+	}
+
+	// One input buffer per thread, reused across positions.
+	thread_local std::vector<float> input;
+	input.resize(state.StateSize());
+	state.EncodeState(input.data());
+	rawEvaluation = network.Evaluate(input.data());
+	Store(key, rawEvaluation);
+	return rawEvaluation;
+}
+
+float EvaluationCache::GetClampedEvaluation(const NeuralNetwork& network, const IGame& state)
+{
+	return network.ClampEvaluation(Evaluate(network, state));
+}
+
+uint64_t EvaluationCache::Key(uint64_t positionHash, const NeuralNetwork& network)
+{
+	uint64_t networkKey = Random::Mix((static_cast<uint64_t>(network.Id) << 32) ^ network.Version());
+	return Random::Mix(positionHash ^ networkKey);
+}
+
+bool EvaluationCache::Probe(uint64_t key, float& rawEvaluation) const
+{
+	const Bucket& bucket = m_buckets[key & (m_bucketCount - 1)];
+	for (const Entry& entry : bucket.Entries)
+	{
+		uint64_t data = entry.Data.load(std::memory_order_relaxed);
+		if ((entry.Check.load(std::memory_order_relaxed) ^ data) == key)
+		{
+			uint32_t bits = static_cast<uint32_t>(data);
+			std::memcpy(&rawEvaluation, &bits, sizeof(rawEvaluation));
+			m_hits.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	m_misses.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+void EvaluationCache::Store(uint64_t key, float rawEvaluation)
+{
+	Bucket& bucket = m_buckets[key & (m_bucketCount - 1)];
+
+	// Empty entries first, otherwise a way picked by the key's top bits, which are unrelated to the bucket index.
+	Entry* target = &bucket.Entries[key >> 62];
+	for (Entry& entry : bucket.Entries)
+	{
+		if ((entry.Check.load(std::memory_order_relaxed) | entry.Data.load(std::memory_order_relaxed)) == 0)
+		{
+			target = &entry;
+			break;
+		}
+	}
+
+	uint32_t bits;
+	std::memcpy(&bits, &rawEvaluation, sizeof(bits));
+	// The upper half keeps Data from being zero, which marks an empty entry.
+	uint64_t data = (static_cast<uint64_t>(1) << 32) | bits;
+	target->Data.store(data, std::memory_order_relaxed);
+	target->Check.store(key ^ data, std::memory_order_relaxed);
+}
+
+size_t EvaluationCache::MemoryBytes() const
+{
+	return m_bucketCount * sizeof(Bucket);
+}
+
+long long EvaluationCache::Hits() const
+{
+	return m_hits.load(std::memory_order_relaxed);
+}
+
+long long EvaluationCache::Misses() const
+{
+	return m_misses.load(std::memory_order_relaxed);
+}
+
+double EvaluationCache::HitRate() const
+{
+	long long lookups = Hits() + Misses();
+	return lookups > 0 ? static_cast<double>(Hits()) / lookups : 0.0;
+}
+
+void EvaluationCache::ResetStats()
+{
+	m_hits.store(0, std::memory_order_relaxed);
+	m_misses.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,123 @@
+#include "GameModules.h"
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef _WIN32
+	const char* ModuleExtension = ".dll";
+
+	void* OpenModule(const std::string& path)
+	{
+		return LoadLibraryA(path.c_str());
+	}
+
+	void* FindSymbol(void* handle, const char* name)
+	{
+		return reinterpret_cast<void*>(GetProcAddress(static_cast<HMODULE>(handle), name));
+	}
+
+	void CloseModule(void* handle)
+	{
+		FreeLibrary(static_cast<HMODULE>(handle));
+	}
+#else
+	const char* ModuleExtension = ".so";
+
+	void* OpenModule(const std::string& path)
+	{
+		return dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+	}
+
+	void* FindSymbol(void* handle, const char* name)
+	{
+		return dlsym(handle, name);
+	}
+
+	void CloseModule(void* handle)
+	{
+		dlclose(handle);
+	}
+#endif
+}
+
+void GameModules::LoadAll(const std::string& directory)
+{
+	std::string moduleDir = directory.empty() ? ExecutableDirectory() : directory;
+	std::error_code error;
+	std::vector<std::string> paths;
+	for (const auto& file : std::filesystem::directory_iterator(moduleDir, error))
+	{
+		if (file.path().extension() == ModuleExtension)
+		{
+			paths.push_back(file.path().string());
+		}
+	}
+	// Sorted, so games are listed in the same order on every system.
+	std::sort(paths.begin(), paths.end());
+
+	for (const std::string& path : paths)
+	{
+		void* handle = OpenModule(path);
+		if (!handle)
+		{
+			continue;
+		}
+
+		auto getName = reinterpret_cast<GetGameNameFunc>(FindSymbol(handle, "GetGameName"));
+		auto createGame = reinterpret_cast<CreateGameFunc>(FindSymbol(handle, "CreateGame"));
+		auto createEngine = reinterpret_cast<CreateSimulationEngineFunc>(FindSymbol(handle, "CreateSimulationEngine"));
+		auto createOracle = reinterpret_cast<CreateGameOracleFunc>(FindSymbol(handle, "CreateGameOracle"));
+		auto createBatch = reinterpret_cast<CreateBatchEnvironmentFunc>(FindSymbol(handle, "CreateBatchEnvironment"));
+		if (getName && createGame)
+		{
+			m_games.push_back({ handle, getName(), createGame, createEngine, createOracle, createBatch });
+		}
+		else
+		{
+			CloseModule(handle);
+		}
+	}
+}
+
+const std::vector<GameModules::Entry>& GameModules::Games() const
+{
+	return m_games;
+}
+
+const GameModules::Entry* GameModules::Find(const std::string& name) const
+{
+	for (const Entry& entry : m_games)
+	{
+		if (entry.Name == name)
+		{
+			return &entry;
+		}
+	}
+	return nullptr;
+}
+
+std::string GameModules::ExecutableDirectory()
+{
+#ifdef _WIN32
+	char buffer[MAX_PATH];
+	DWORD length = GetModuleFileNameA(NULL, buffer, MAX_PATH);
+	std::string exePath(buffer, length);
+#else
+	char buffer[4096];
+	ssize_t length = readlink("/proc/self/exe", buffer, sizeof(buffer) - 1);
+	std::string exePath(buffer, length > 0 ? static_cast<size_t>(length) : 0);
+#endif
+	size_t lastSlash = exePath.find_last_of("\\/");
+	return lastSlash == std::string::npos ? "." : exePath.substr(0, lastSlash);
+}
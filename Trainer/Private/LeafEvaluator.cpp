@@ -0,0 +1,104 @@
+#include "LeafEvaluator.h"
+#include "SimulationEngine.h"
+
+NeuralLeafEvaluator::NeuralLeafEvaluator(const NeuralNetwork* network, EvaluationCache* cache) : m_network(network), m_cache(cache)
+{
+	;
+}
+
+float NeuralLeafEvaluator::Evaluate(IGame& state, std::mt19937& /*rng*/, std::vector<PlayedMove>* /*trace*/) const
+{
+	if (m_cache)
+	{
+		return m_cache->GetClampedEvaluation(*m_network, state);
+	}
+
+	// One input buffer per thread, reused across leaves.
+	thread_local std::vector<float> input;
+	input.resize(state.StateSize());
+	state.EncodeState(input.data());
+	return m_network->GetClampedEvaluation(input.data());
+}
+
+RandomPlayoutEvaluator::RandomPlayoutEvaluator(int playouts, int maxPlayoutMoves, const SimulationEngine* engine)
+	: m_playouts(playouts), m_maxPlayoutMoves(maxPlayoutMoves), m_engine(engine)
+{
+	;
+}
+
+float RandomPlayoutEvaluator::Evaluate(IGame& state, std::mt19937& rng, std::vector<PlayedMove>* trace) const
+{
+	if (m_engine)
+	{
+		return m_engine->RandomPlayouts(state, rng, m_playouts, m_maxPlayoutMoves, trace);
+	}
+
+	float total = 0.0f;
+	MoveList moves;
+	for (int playout = 0; playout < m_playouts; ++playout)
+	{
+		int movesMade = 0;
+		while (state.GetWinner() == IGame::Winner::OnGoing && movesMade < m_maxPlayoutMoves)
+		{
+			int moveCount = state.GenerateMoves(moves);
+			if (moveCount == 0)
+			{
+				break;
+			}
+
+			int player = state.GetCurrentPlayer();
+			int move = moves[std::uniform_int_distribution<int>(0, moveCount - 1)(rng)];
+			state.MakeMove(move);
+			++movesMade;
+
+			if (trace && playout == 0)
+			{
+				trace->push_back({ player, move });
+			}
+		}
+
+		if (state.GetWinner() == IGame::Winner::FirstPlayer)
+		{
+			total += 1.0f;
+		}
+		else if (state.GetWinner() == IGame::Winner::SecondPlayer)
+		{
+			total -= 1.0f;
+		}
+
+		for (int i = 0; i < movesMade; ++i)
+		{
+			state.UnMakeMove();
+		}
+	}
+	return total / m_playouts;
+}
+
+MixedLeafEvaluator::MixedLeafEvaluator(const LeafEvaluator& valueEvaluator, const LeafEvaluator& playoutEvaluator, float lambda)
+	: m_valueEvaluator(valueEvaluator), m_playoutEvaluator(playoutEvaluator), m_lambda(lambda)
+{
+	;
+}
+
+float MixedLeafEvaluator::Evaluate(IGame& state, std::mt19937& rng, std::vector<PlayedMove>* trace) const
+{
+	float value = m_lambda < 1.0f ? m_valueEvaluator.Evaluate(state, rng, trace) : 0.0f;
+	float playout = m_lambda > 0.0f ? m_playoutEvaluator.Evaluate(state, rng, trace) : 0.0f;
+	return (1.0f - m_lambda) * value + m_lambda * playout;
+}
+
+OracleLeafEvaluator::OracleLeafEvaluator(const GameOracle& oracle, const LeafEvaluator& fallback)
+	: m_oracle(oracle), m_fallback(fallback)
+{
+	;
+}
+
+float OracleLeafEvaluator::Evaluate(IGame& state, std::mt19937& rng, std::vector<PlayedMove>* trace) const
+{
+	float value;
+	if (m_oracle.Probe(state, value))
+	{
+		return value;
+	}
+	return m_fallback.Evaluate(state, rng, trace);
+}
@@ -1,8 +1,144 @@
 #include <iostream>
+#include <string>
+#include "Benchmark.h"
+#include "GameModules.h"
+#include "Trainer.h"
+#include "TrainingConfig.h"
+#ifndef TRAINER_HEADLESS
 #include "Selector.h"
+#endif
 
-int main()
+/// <summary>Trainer --train [--config file] [--key value]...: trains without prompts, console or window.</summary>
+static int RunHeadlessTraining(int argc, char** argv)
 {
+    TrainingConfig config;
+    std::string error;
+    if (!TrainingConfig::Parse(argc, argv, 2, config, error))
+    {
+        std::cerr << error << "\n" << TrainingConfig::Usage();
+        return 2;
+    }
+
+    GameModules modules;
+    modules.LoadAll(config.Modules);
+    const GameModules::Entry* entry = modules.Find(config.Game);
+    if (!entry)
+    {
+        std::cerr << "No game module for " << config.Game << ". Loaded:";
+        for (const GameModules::Entry& game : modules.Games())
+        {
+            std::cerr << " " << game.Name << ";";
+        }
+        std::cerr << "\n";
+        return 2;
+    }
+
+    std::unique_ptr<IGame> game(entry->CreateFunc());
+    std::unique_ptr<SimulationEngine> engine(entry->CreateEngineFunc ? entry->CreateEngineFunc() : nullptr);
+    std::unique_ptr<GameOracle> oracle(entry->CreateOracleFunc ? entry->CreateOracleFunc() : nullptr);
+    Trainer trainer(std::move(game), std::move(engine), std::move(oracle));
+    return trainer.RunHeadless(config);
+}
+
+/// <summary>Trainer --bench-games [results.jsonl] [--baseline previous.jsonl]: runs the benchmark suite for every game module
+/// without prompts and writes the results as JSON lines. Also replays random make/unmake sequences against position snapshots
+/// and checks batch environments against the games. Returns the number of perft counts that differ from the baseline plus
+/// the failed checks, or -1 when a file can't be used.</summary>
+static int RunBenchmarks(const std::string& outputPath, const std::string& baselinePath)
+{
+    GameModules modules;
+    modules.LoadAll();
+
+    std::vector<Benchmark::SuiteResult> results;
+    int checkFailures = 0;
+    for (const GameModules::Entry& gameEntry : modules.Games())
+    {
+        std::unique_ptr<IGame> game(gameEntry.CreateFunc());
+        std::unique_ptr<SimulationEngine> engine(gameEntry.CreateEngineFunc ? gameEntry.CreateEngineFunc() : nullptr);
+        std::cout << "Benchmarking " << gameEntry.Name << "...\n";
+        for (const Benchmark::SuiteResult& result : Benchmark::RunGameSuite(*game, engine.get(), Benchmark::SuiteSettings()))
+        {
+            std::cout << "  " << result.Test << ": " << result.Count << " in " << result.Seconds << " s ("
+                << static_cast<long long>(result.Rate) << "/s)\n";
+            results.push_back(result);
+        }
+
+        std::mt19937 rng(12345);
+        Benchmark::UndoCheckResult undo = Benchmark::CheckUndo(*game, 200, rng);
+        std::cout << "  undo_check: " << undo.Undos << " undos, " << undo.Mismatches << " mismatches\n";
+        checkFailures += static_cast<int>(undo.Mismatches);
+
+        if (gameEntry.CreateBatchFunc)
+        {
+            std::unique_ptr<BatchEnvironment> batch(gameEntry.CreateBatchFunc(256));
+            Benchmark::BatchCheckResult check = Benchmark::CheckBatchEnvironment(*game, *batch, 4000, rng);
+            Benchmark::SuiteResult result;
+            result.Game = gameEntry.Name;
+            result.Test = "batch_steps";
+            result.Count = check.Moves;
+            result.Seconds = check.BatchSeconds;
+            result.Rate = check.BatchSeconds > 0.0 ? check.Moves / check.BatchSeconds : 0.0;
+            std::cout << "  batch_steps: " << check.Moves << " moves, " << static_cast<long long>(result.Rate) << " moves/s batched, "
+                << static_cast<long long>(check.GameSeconds > 0.0 ? check.Moves / check.GameSeconds : 0.0) << " moves/s through IGame, "
+                << check.Mismatches << " mismatches\n";
+            results.push_back(result);
+            checkFailures += static_cast<int>(check.Mismatches);
+        }
+    }
+
+    if (!Benchmark::WriteSuiteResults(outputPath, results))
+    {
+        std::cout << "Could not write benchmark results to " << outputPath << "\n";
+        return -1;
+    }
+    std::cout << "Wrote " << results.size() << " results to " << outputPath << "\n";
+
+    if (baselinePath.empty())
+    {
+        return checkFailures;
+    }
+    std::vector<Benchmark::SuiteResult> baseline = Benchmark::ReadSuiteResults(baselinePath);
+    if (baseline.empty())
+    {
+        std::cout << "Could not read baseline " << baselinePath << "\n";
+        return -1;
+    }
+    int mismatches = Benchmark::CompareToBaseline(results, baseline);
+    std::cout << mismatches << " perft counts differ from the baseline\n";
+    return mismatches + checkFailures;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && std::string(argv[1]) == "--train")
+    {
+        return RunHeadlessTraining(argc, argv);
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--bench-games")
+    {
+        std::string outputPath = "bench_games.jsonl";
+        std::string baselinePath;
+        for (int i = 2; i < argc; ++i)
+        {
+            std::string argument = argv[i];
+            if (argument == "--baseline" && i + 1 < argc)
+            {
+                baselinePath = argv[++i];
+            }
+            else
+            {
+                outputPath = argument;
+            }
+        }
+        return RunBenchmarks(outputPath, baselinePath) == 0 ? 0 : 1;
+    }
+
+#ifdef TRAINER_HEADLESS
+    std::cerr << TrainingConfig::Usage() << "Trainer --bench-games [results.jsonl] [--baseline previous.jsonl]\n";
+    return 2;
+#else
     GameSelector Selector;
     Selector.Start();
+#endif
 }
\ No newline at end of file
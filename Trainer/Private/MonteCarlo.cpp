@@ -1,148 +1,365 @@
 #include "MonteCarlo.h"
+#include "Random.h"
 #include <iostream>
 #include <thread>
-
-
-void MonteCarlo::RunMCTSLoop(IGame* initialState, std::chrono::high_resolution_clock::time_point startTime, std::chrono::duration<double> timeRestriction, treeNode* root, NeuralNetwork* ai, int rootPlayer)
+#include <limits>
+#include <climits>
+#include <random>
+#include <atomic>
+#include <shared_mutex>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <condition_variable>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace
 {
-	while (std::chrono::high_resolution_clock::now() - startTime < timeRestriction) 
+	double SecondsSince(std::chrono::high_resolution_clock::time_point start)
 	{
-		PerformMCTSTurn(*initialState, root, ai, rootPlayer);
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
 	}
-	return;
-}
 
-void MonteCarlo::PerformMCTSTurn(IGame& initialState, treeNode* rootNode, NeuralNetwork* ai, int rootPlayer)
-{
-	treeNode* node = rootNode;
-	while (!node->Children.empty()) 
+	void LockSharedCounted(std::shared_mutex& mutex, SearchStats& stats)
 	{
-		node = SelectNodeUCB(node, initialState.GetCurrentPlayer() == 1);
-		if (!initialState.MakeMove(node->PreviousMove))
+		if (mutex.try_lock_shared())
 		{
-			std::cout << "Impossible move attempted!\n";
-			initialState.PrintBoard();
-			std::cout << "Attempted move: " << node->PreviousMove << "\n";
+			return;
 		}
+		std::chrono::high_resolution_clock::time_point waitStart = std::chrono::high_resolution_clock::now();
+		mutex.lock_shared();
+		stats.ContendedLocks++;
+		stats.LockWaitSeconds += SecondsSince(waitStart);
 	}
 
-	if (!ExpandNode(initialState, node))
+	/// <summary>Runs numbered jobs on a fixed set of threads plus the calling one. Results must not depend on which thread runs a job.</summary>
+	class JobWorkers
 	{
-		while (node->Parent != nullptr) 
+	public:
+		JobWorkers(unsigned int extraThreads)
 		{
-			node = node->Parent;
-			initialState.UnMakeMove();
+			for (unsigned int i = 0; i < extraThreads; ++i)
+			{
+				m_threads.emplace_back([this]() { WorkerLoop(); });
+			}
 		}
-		return;
-	}
 
-	float score = 0;
-	if (initialState.GetWinner() == IGame::Winner::FirstPlayer)
-	{
-		score = 1;
-	}
-	else if (initialState.GetWinner() == IGame::Winner::SecondPlayer)
-	{
-		score = -1;
-	}
-	else if (initialState.GetWinner() == IGame::Winner::Draw)
+		~JobWorkers()
+		{
+			m_mutex.lock();
+			m_stop = true;
+			m_mutex.unlock();
+			m_wake.notify_all();
+			for (auto& thread : m_threads)
+			{
+				thread.join();
+			}
+		}
+
+		/// <summary>Runs job(0) to job(count - 1) and returns once all of them have finished.</summary>
+		void Run(int count, const std::function<void(int)>& job)
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_job = &job;
+			m_count = count;
+			m_next = 0;
+			m_finished = 0;
+			m_generation++;
+			m_wake.notify_all();
+			RunClaimedJobs(lock);
+			m_done.wait(lock, [this]() { return m_finished == m_count; });
+			m_job = nullptr;
+		}
+
+	private:
+		void WorkerLoop()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			unsigned long long seenGeneration = 0;
+			while (true)
+			{
+				m_wake.wait(lock, [&]() { return m_stop || (m_generation != seenGeneration && m_next < m_count); });
+				if (m_stop)
+				{
+					return;
+				}
+				seenGeneration = m_generation;
+				RunClaimedJobs(lock);
+			}
+		}
+
+		void RunClaimedJobs(std::unique_lock<std::mutex>& lock)
+		{
+			while (m_next < m_count)
+			{
+				int index = m_next++;
+				lock.unlock();
+				(*m_job)(index);
+				lock.lock();
+				if (++m_finished == m_count)
+				{
+					m_done.notify_all();
+				}
+			}
+		}
+
+		std::vector<std::thread> m_threads;
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_done;
+		const std::function<void(int)>* m_job = nullptr;
+		int m_count = 0;
+		int m_next = 0;
+		int m_finished = 0;
+		unsigned long long m_generation = 0;
+		bool m_stop = false;
+	};
+
+	/// <summary>One leaf of a deterministic round, with its own board and random stream.</summary>
+	struct DeterministicSlot
 	{
-		score = 0;
-	}
-	else
+		std::unique_ptr<IGame> Board;
+		std::mt19937 Rng;
+		std::vector<PlayedMove> Path;
+		std::vector<VirtualLoss> Losses;
+		bool NeedsEvaluation = false;
+		float Score = 0.0f;
+	};
+
+}
+
+struct MonteCarlo::SearchContext : SearchTree
+{
+	SearchContext(const LeafEvaluator& evaluator, const SearchSettings& settings, int rootPlayer)
+		: SearchTree(evaluator, settings, NodeBytes), RootPlayer(rootPlayer),
+		Engine(settings.Engine ? *settings.Engine : SimulationEngine::ThroughInterface()),
+		StartTime(std::chrono::high_resolution_clock::now()),
+		StartMemory(GetProcessMemory()),
+		Seed(settings.Seed != 0 ? settings.Seed : Random::NextTaskSeed(RandomDomain::Search))
 	{
-		score = ai->GetClampedEvaluation(initialState.GetBoardState());
+		Stats.Seed = Seed;
 	}
 
-	//initialState.PrintBoard();
-	//std::cout << "Evaluation: " << score << "\n";
+	int RootPlayer;
+	/// <summary>Runs the game loops of the search, inside the game module when it exports an engine.</summary>
+	const SimulationEngine& Engine;
+	std::chrono::high_resolution_clock::time_point StartTime;
+	ProcessMemory StartMemory;
+	/// <summary>Task seed the random streams of all threads are split from.</summary>
+	uint64_t Seed;
+	/// <summary>Totals of all finished threads.</summary>
+	SearchStats Stats;
+	std::mutex StatsMutex;
+};
+
+void SearchStats::Merge(const SearchStats& other)
+{
+	Iterations += other.Iterations;
+	NodesCreated += other.NodesCreated;
+	Expansions += other.Expansions;
+	MaxDepth = std::max(MaxDepth, other.MaxDepth);
+	TotalDepth += other.TotalDepth;
+	LeafEvaluations += other.LeafEvaluations;
+	TerminalHits += other.TerminalHits;
+	SelectionSeconds += other.SelectionSeconds;
+	ExpansionSeconds += other.ExpansionSeconds;
+	EvaluationSeconds += other.EvaluationSeconds;
+	BackupSeconds += other.BackupSeconds;
+	ContendedLocks += other.ContendedLocks;
+	LockWaitSeconds += other.LockWaitSeconds;
+}
+
+double SearchStats::AverageDepth() const
+{
+	return Iterations == 0 ? 0.0 : static_cast<double>(TotalDepth) / Iterations;
+}
+
+double SearchStats::AverageBranching() const
+{
+	return Expansions == 0 ? 0.0 : static_cast<double>(NodesCreated) / Expansions;
+}
+
+double SearchStats::IterationsPerSecond() const
+{
+	return WallSeconds <= 0.0 ? 0.0 : Iterations / WallSeconds;
+}
+
+double SearchStats::NodesPerSecond() const
+{
+	return WallSeconds <= 0.0 ? 0.0 : NodesCreated / WallSeconds;
+}
 
-	/*if (initialState.GetCurrentPlayer() != rootPlayer) 
+std::string SearchStats::ToJson() const
+{
+	std::ostringstream json;
+	json << "{\"iterations\":" << Iterations
+		<< ",\"nodes_created\":" << NodesCreated
+		<< ",\"expansions\":" << Expansions
+		<< ",\"max_depth\":" << MaxDepth
+		<< ",\"average_depth\":" << AverageDepth()
+		<< ",\"average_branching\":" << AverageBranching()
+		<< ",\"leaf_evaluations\":" << LeafEvaluations
+		<< ",\"terminal_hits\":" << TerminalHits
+		<< ",\"selection_seconds\":" << SelectionSeconds
+		<< ",\"expansion_seconds\":" << ExpansionSeconds
+		<< ",\"evaluation_seconds\":" << EvaluationSeconds
+		<< ",\"backup_seconds\":" << BackupSeconds
+		<< ",\"contended_locks\":" << ContendedLocks
+		<< ",\"lock_wait_seconds\":" << LockWaitSeconds
+		<< ",\"wall_seconds\":" << WallSeconds
+		<< ",\"threads\":" << Threads
+		<< ",\"seed\":" << Seed
+		<< ",\"iterations_per_second\":" << IterationsPerSecond()
+		<< ",\"nodes_per_second\":" << NodesPerSecond()
+		<< "}";
+	return json.str();
+}
+
+void MonteCarlo::MergeThreadStats(SearchContext& context, const SearchStats& stats)
+{
+	context.StatsMutex.lock();
+	context.Stats.Merge(stats);
+	context.Stats.Threads++;
+	context.StatsMutex.unlock();
+}
+
+
+void MonteCarlo::RunMCTSLoop(IGame* initialState, std::chrono::high_resolution_clock::time_point startTime, std::chrono::duration<double> timeRestriction, SearchContext& context, unsigned int threadIndex)
+{
+	std::vector<PlayedMove> path;
+	std::mt19937 rng = Random::MakeGenerator(context.Seed, threadIndex);
+	SearchStats stats;
+	while (std::chrono::high_resolution_clock::now() - startTime < timeRestriction) 
 	{
-		score = -score;
-	}*/
+		PerformMCTSTurn(*initialState, context, path, rng, stats);
+	}
+	MergeThreadStats(context, stats);
+	return;
+}
 
-	while (node->Parent != nullptr) 
+void MonteCarlo::PerformMCTSTurn(IGame& initialState, SearchContext& context, std::vector<PlayedMove>& path, std::mt19937& rng, SearchStats& stats)
+{
+	std::chrono::high_resolution_clock::time_point phaseStart = std::chrono::high_resolution_clock::now();
+	if (context.RecycleRequested)
+	{
+		LockCounted(context.TreeMutex, stats);
+		std::unique_lock<std::shared_mutex> exclusive(context.TreeMutex, std::adopt_lock);
+		if (context.RecycleRequested)
+		{
+			RecycleSubtrees(context);
+			context.RecycleRequested = false;
+		}
+	}
+	std::shared_lock<std::shared_mutex> shared;
+	if (context.Recycling)
 	{
-		node->ValueChangeMute.lock();
-		node->Visits++;
-		node->TotalScore += score;
-		node->ValueChangeMute.unlock();
-		node = node->Parent;
-		initialState.UnMakeMove();
-		//score *= 0.75f;
+		LockSharedCounted(context.TreeMutex, stats);
+		shared = std::shared_lock<std::shared_mutex>(context.TreeMutex, std::adopt_lock);
 	}
-	node->ValueChangeMute.lock();
-	node->Visits++;
-	node->TotalScore += score;
-	node->ValueChangeMute.unlock();
+	stats.SelectionSeconds += SecondsSince(phaseStart);
+
+	context.Engine.SearchIteration(initialState, context, path, rng, stats);
 }
 
-void MonteCarlo::RunMCTSLoop(IGame* initialState, int iterations, treeNode* root, NeuralNetwork* ai, int rootPlayer)
+void MonteCarlo::RunMCTSLoop(IGame* initialState, int iterations, SearchContext& context, unsigned int threadIndex)
 {
-	while (root->Visits < iterations)
+	std::vector<PlayedMove> path;
+	std::mt19937 rng = Random::MakeGenerator(context.Seed, threadIndex);
+	SearchStats stats;
+	while (context.Root->Visits < iterations)
 	{
-		PerformMCTSTurn(*initialState, root, ai, rootPlayer);
+		PerformMCTSTurn(*initialState, context, path, rng, stats);
 	}
+	MergeThreadStats(context, stats);
 	return;
 }
 
-int MonteCarlo::MonteCarloTreeSearch(IGame& initialState, float seconds, NeuralNetwork* ai)
+MonteCarlo::EvaluationAndMove MonteCarlo::MonteCarloTreeSearch(IGame& initialState, float seconds, NeuralNetwork* ai, const SearchSettings& settings)
+{
+	NeuralLeafEvaluator evaluator(ai);
+	return MonteCarloTreeSearch(initialState, seconds, evaluator, settings);
+}
+
+MonteCarlo::EvaluationAndMove MonteCarlo::MonteCarloTreeSearch(IGame& initialState, float seconds, const LeafEvaluator& evaluator, const SearchSettings& settings)
 {
-	treeNode* rootNode = new treeNode();
-	rootNode->Visits = 1;
-	ExpandNode(initialState, rootNode);
+	SearchContext context(evaluator, settings, initialState.GetCurrentPlayer());
+	EvaluationAndMove bookResult;
+	if (ProbeBook(initialState, context, bookResult))
+	{
+		return bookResult;
+	}
+	CreateRoot(initialState, context);
 
 	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
 	std::chrono::duration<double> timeRestrictionInSeconds = std::chrono::duration<double>(seconds);
 
+	if (settings.Deterministic)
+	{
+		RunDeterministicSearch(initialState, context, INT_MAX, timeRestrictionInSeconds);
+		return FinishSearch(context, initialState);
+	}
+
 	std::vector<std::thread> threads;
 	std::vector<std::unique_ptr<IGame>> boards;
 
-	int rootPlayer = initialState.GetCurrentPlayer();
-
-	for (int i = 0; i < 1; ++i) 
+	for (unsigned int i = 0; i < 1; ++i) 
 	{
 		auto boardCopy = initialState.Clone();
-		threads.emplace_back([boardCopy = std::move(boardCopy), startTime, timeRestrictionInSeconds, rootNode, ai, rootPlayer]() mutable 
+		threads.emplace_back([boardCopy = std::move(boardCopy), startTime, timeRestrictionInSeconds, &context, i]() mutable 
 		{
-			RunMCTSLoop(boardCopy.get(), startTime, timeRestrictionInSeconds, rootNode, ai, rootPlayer);
+			RunMCTSLoop(boardCopy.get(), startTime, timeRestrictionInSeconds, context, i);
 		});
 	}
 	for (auto& thread : threads) 
 	{
 		thread.join();
 	}
-	int bestAction = SelectBestAction(*rootNode, initialState);
 
-	delete rootNode;
-	
-	return bestAction;
+	return FinishSearch(context, initialState);
 }
 
-MonteCarlo::EvaluationAndMove MonteCarlo::MonteCarloTreeSearch(IGame& initialState, int iterations, NeuralNetwork* ai)
+MonteCarlo::EvaluationAndMove MonteCarlo::MonteCarloTreeSearch(IGame& initialState, int iterations, NeuralNetwork* ai, const SearchSettings& settings)
 {
-	treeNode* rootNode = new treeNode();
-	rootNode->Visits = 1;
-	ExpandNode(initialState, rootNode);
+	NeuralLeafEvaluator evaluator(ai);
+	return MonteCarloTreeSearch(initialState, iterations, evaluator, settings);
+}
 
-	int rootPlayer = initialState.GetCurrentPlayer();
+MonteCarlo::EvaluationAndMove MonteCarlo::MonteCarloTreeSearch(IGame& initialState, int iterations, const LeafEvaluator& evaluator, const SearchSettings& settings)
+{
+	SearchContext context(evaluator, settings, initialState.GetCurrentPlayer());
+	EvaluationAndMove bookResult;
+	if (ProbeBook(initialState, context, bookResult))
+	{
+		return bookResult;
+	}
+	CreateRoot(initialState, context);
 
-	if (iterations < 500) {
+	if (settings.Deterministic) {
+		RunDeterministicSearch(initialState, context, iterations, std::chrono::duration<double>::max());
+	}
+	else if (iterations < 500) {
 		auto boardCopy = initialState.Clone();
-		RunMCTSLoop(boardCopy.get(), iterations, rootNode, ai, rootPlayer);
+		RunMCTSLoop(boardCopy.get(), iterations, context, 0);
 	}
 	else {
-		unsigned int threadCount = std::thread::hardware_concurrency();
+		unsigned int threadCount = settings.Threads > 0 ? settings.Threads : std::thread::hardware_concurrency();
 		if (threadCount == 0) threadCount = 4;
 
 		std::vector<std::thread> threads;
 		for (unsigned int i = 0; i < threadCount; ++i)
 		{
 			auto boardCopy = initialState.Clone();
-			threads.emplace_back([boardCopy = std::move(boardCopy), iterations, rootNode, ai, rootPlayer]() mutable
+			threads.emplace_back([boardCopy = std::move(boardCopy), iterations, &context, i]() mutable
 			{
-				RunMCTSLoop(boardCopy.get(), iterations, rootNode, ai, rootPlayer);
+				RunMCTSLoop(boardCopy.get(), iterations, context, i);
 			});
 		}
 
@@ -152,12 +369,157 @@ MonteCarlo::EvaluationAndMove MonteCarlo::MonteCarloTreeSearch(IGame& initialSta
 		}
 	}
 
+	return FinishSearch(context, initialState);
+}
+
+void MonteCarlo::RunDeterministicSearch(IGame& initialState, SearchContext& context, int iterations, std::chrono::duration<double> timeRestriction)
+{
+	const SearchSettings& settings = context.Settings;
+	int batchSize = std::max(settings.DeterministicBatchSize, 1);
+	unsigned int threadCount = settings.Threads > 0 ? settings.Threads : std::thread::hardware_concurrency();
+	if (threadCount == 0) threadCount = 4;
+	threadCount = std::min(threadCount, static_cast<unsigned int>(batchSize));
+
+	std::vector<DeterministicSlot> slots(batchSize);
+	for (int i = 0; i < batchSize; ++i)
+	{
+		slots[i].Board = initialState.Clone();
+		slots[i].Rng = Random::MakeGenerator(context.Seed, i);
+	}
+	JobWorkers workers(threadCount - 1);
+	SearchStats stats;
+	treeNode* root = context.Root;
+
+	while (root->Visits < iterations && std::chrono::high_resolution_clock::now() - context.StartTime < timeRestriction)
+	{
+		if (context.RecycleRequested)
+		{
+			RecycleSubtrees(context);
+			context.RecycleRequested = false;
+		}
+
+		// Selection and expansion, one leaf after another. Every visited node takes a virtual loss for the player
+		// who moved into it, which steers the following leaves of the round elsewhere.
+		std::chrono::high_resolution_clock::time_point phaseStart = std::chrono::high_resolution_clock::now();
+		double expansionBefore = stats.ExpansionSeconds;
+		int roundSize = std::min(batchSize, iterations - root->Visits);
+		for (int i = 0; i < roundSize; ++i)
+		{
+			DeterministicSlot& slot = slots[i];
+			IGame::Winner winner = context.Engine.SelectLeaf(*slot.Board, context, slot.Path, slot.Losses, stats);
+			slot.NeedsEvaluation = winner == IGame::Winner::OnGoing;
+			if (slot.NeedsEvaluation)
+			{
+				stats.LeafEvaluations++;
+			}
+			else
+			{
+				stats.TerminalHits++;
+				slot.Score = winner == IGame::Winner::FirstPlayer ? 1.0f : winner == IGame::Winner::SecondPlayer ? -1.0f : 0.0f;
+			}
+		}
+		std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+		stats.SelectionSeconds += std::chrono::duration<double>(now - phaseStart).count() - (stats.ExpansionSeconds - expansionBefore);
+		phaseStart = now;
+
+		workers.Run(roundSize, [&](int i)
+		{
+			DeterministicSlot& slot = slots[i];
+			if (slot.NeedsEvaluation)
+			{
+				slot.Score = context.Evaluator.Evaluate(*slot.Board, slot.Rng, settings.UseRave ? &slot.Path : nullptr);
+			}
+		});
+		now = std::chrono::high_resolution_clock::now();
+		stats.EvaluationSeconds += std::chrono::duration<double>(now - phaseStart).count();
+		phaseStart = now;
+
+		// Backup in selection order, replacing each virtual loss with the real result.
+		for (int i = 0; i < roundSize; ++i)
+		{
+			DeterministicSlot& slot = slots[i];
+			context.Engine.BackupLeaf(*slot.Board, context, slot.Path, slot.Losses, slot.Score, stats);
+		}
+		stats.BackupSeconds += SecondsSince(phaseStart);
+	}
+
+	context.Stats.Merge(stats);
+	context.Stats.Threads = static_cast<int>(threadCount);
+}
+
+MonteCarlo::EvaluationAndMove MonteCarlo::FinishSearch(SearchContext& context, IGame& initialState)
+{
+	treeNode* rootNode = context.Root;
 	int bestAction = SelectBestAction(*rootNode, initialState);
 
 	float evaluation = static_cast<float>(rootNode->TotalScore == 0.0f ? 0.0f : rootNode->TotalScore/ static_cast<double>(rootNode->Visits));
+	context.Stats.WallSeconds = SecondsSince(context.StartTime);
+	std::vector<RootMove> rootMoves;
+	for (treeNode* child : rootNode->Children)
+	{
+		rootMoves.push_back({ child->PreviousMove, child->Visits });
+	}
+	ProcessMemory endMemory = GetProcessMemory();
 	delete rootNode;
+	context.Root = nullptr;
+
+	MemoryUsage memory;
+	memory.PeakNodes = context.PeakNodeCount;
+	memory.PeakTreeBytes = memory.PeakNodes * NodeBytes;
+	memory.RecycledNodes = context.RecycledNodes;
+	memory.ProcessGrowthBytes = ProcessGrowth(context.StartMemory, endMemory);
 
-	return { bestAction, evaluation };
+	EvaluationAndMove result = { bestAction, evaluation, memory, context.Stats, std::move(rootMoves) };
+	if (!context.Settings.StatsLogPath.empty())
+	{
+		LogStats(context.Settings.StatsLogPath, result);
+	}
+	return result;
+}
+
+bool MonteCarlo::ProbeBook(IGame& initialState, const SearchContext& context, EvaluationAndMove& result)
+{
+	const SearchSettings& settings = context.Settings;
+	if (!settings.Book)
+	{
+		return false;
+	}
+
+	// A stream of the search's own seed that no thread uses, so consulting the book doesn't shift the seeds of later searches.
+	std::mt19937 rng = Random::MakeGenerator(context.Seed, 1u << 16);
+	int move;
+	float value;
+	if (!settings.Book->Lookup(initialState, settings.BookMaxPly, settings.BookTemperature, rng, move, value))
+	{
+		return false;
+	}
+
+	result = EvaluationAndMove();
+	result.Move = move;
+	result.stateEvaluation = value;
+	result.Stats = context.Stats;
+	result.Stats.WallSeconds = SecondsSince(context.StartTime);
+	return true;
+}
+
+void MonteCarlo::LogStats(const std::string& path, const EvaluationAndMove& result)
+{
+	static std::mutex logMutex;
+	std::lock_guard<std::mutex> lock(logMutex);
+	std::ofstream log(path, std::ios::app);
+	if (!log)
+	{
+		std::cout << "Could not open search log " << path << "\n";
+		return;
+	}
+	log << "{\"build\":\"" << __DATE__ << " " << __TIME__ << "\""
+		<< ",\"move\":" << result.Move
+		<< ",\"evaluation\":" << result.stateEvaluation
+		<< ",\"peak_nodes\":" << result.Memory.PeakNodes
+		<< ",\"recycled_nodes\":" << result.Memory.RecycledNodes
+		<< ",\"process_growth_bytes\":" << result.Memory.ProcessGrowthBytes
+		<< ",\"stats\":" << result.Stats.ToJson()
+		<< "}\n";
 }
 
 
@@ -175,6 +537,10 @@ int MonteCarlo::SelectBestAction(treeNode& root, IGame& initialState)
 	}
 	for (treeNode* child : root.Children)
 	{
+		if (child->Visits == 0)
+		{
+			continue;
+		}
 		double score = child->TotalScore / child->Visits;
 		if (initialState.GetCurrentPlayer() == 1)
 		{
@@ -197,75 +563,88 @@ int MonteCarlo::SelectBestAction(treeNode& root, IGame& initialState)
 	return bestMove;
 }
 
-treeNode* MonteCarlo::SelectNodeUCB(treeNode* parent, bool isFirst)
+void MonteCarlo::CreateRoot(IGame& initialState, SearchContext& context)
 {
-	double explorationParameter = 1.41f;
-	treeNode* bestChild = nullptr;
-	bool allScoresZero = true;
-	double bestUCT = INT_MIN;
+	context.Root = new treeNode();
+	context.Root->Visits = 1;
+	context.Engine.ExpandNode(initialState, context.Root, context, context.Stats);
+}
+
+void MonteCarlo::RecycleSubtrees(SearchContext& context)
+{
+	struct Candidate
+	{
+		treeNode* Node;
+		int Depth;
+	};
 
-	parent->ChildrenMutex.lock();
-	for (treeNode* child : parent->Children) 
+	std::vector<Candidate> candidates;
+	std::vector<Candidate> stack = { { context.Root, 0 } };
+	while (!stack.empty())
 	{
-		if (child->Visits == 0) 
+		Candidate current = stack.back();
+		stack.pop_back();
+		for (treeNode* child : current.Node->Children)
 		{
-			allScoresZero = false;
-			bestChild = child;
-			break;
+			if (!child->Children.empty())
+			{
+				candidates.push_back({ child, current.Depth + 1 });
+				stack.push_back({ child, current.Depth + 1 });
+			}
 		}
+	}
 
-		double score = (isFirst ? child->TotalScore : -child->TotalScore);
-		double uct = score / child->Visits + explorationParameter * sqrt(log(parent->Visits) / child->Visits);
-
-		if (uct > bestUCT) 
+	// A child never has more visits than its parent, so deeper nodes are collapsed before any of their ancestors.
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b)
+	{
+		if (a.Node->Visits != b.Node->Visits)
 		{
-			bestUCT = uct;
-			bestChild = child;
+			return a.Node->Visits < b.Node->Visits;
 		}
-	}
-	if (allScoresZero) 
+		return a.Depth > b.Depth;
+	});
+
+	size_t lowWaterMark = context.MaxNodes * 3 / 4;
+	for (const Candidate& candidate : candidates)
 	{
-		int minVisits = INT_MAX;
-		for (treeNode* child : parent->Children) 
+		if (context.NodeCount <= lowWaterMark)
 		{
-			if (child->Visits < minVisits) 
-			{
-				minVisits = child->Visits;
-				bestChild = child;
-			}
+			break;
 		}
+		size_t released = context.Pool.ReleaseChildren(candidate.Node);
+		context.NodeCount -= released;
+		context.RecycledNodes += released;
 	}
-	parent->ChildrenMutex.unlock();
-	return bestChild;
 }
 
-bool MonteCarlo::ExpandNode(IGame& board, treeNode* parent)
+MonteCarlo::ProcessMemory MonteCarlo::GetProcessMemory()
 {
-	parent->ExpansionMutex.lock();
-	parent->ChildrenMutex.lock();
-	if (!parent->Children.empty()) 
+	ProcessMemory memory;
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
 	{
-		parent->ExpansionMutex.unlock();
-		parent->ChildrenMutex.unlock();
-		return false;
+		memory.Resident = counters.WorkingSetSize;
+		memory.PeakResident = counters.PeakWorkingSetSize;
 	}
-	if (board.GetWinner() != IGame::Winner::OnGoing) 
+#else
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	memory.PeakResident = static_cast<size_t>(usage.ru_maxrss) * 1024;
+	std::ifstream statm("/proc/self/statm");
+	size_t totalPages = 0, residentPages = 0;
+	if (statm >> totalPages >> residentPages)
 	{
-		parent->ExpansionMutex.unlock();
-		parent->ChildrenMutex.unlock();
-		return true;
+		memory.Resident = residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
 	}
+#endif
+	return memory;
+}
 
-	std::vector<int> allMoves = board.GetValidMoves();
-	for (auto& move : allMoves) 
-	{
-		treeNode* newNode = new treeNode();
-		newNode->PreviousMove = move;
-		newNode->Parent = parent;
-		parent->Children.push_back(newNode);
-	}
-	parent->ExpansionMutex.unlock();
-	parent->ChildrenMutex.unlock();
-	return true;
+size_t MonteCarlo::ProcessGrowth(const ProcessMemory& start, const ProcessMemory& end)
+{
+	// The lifetime peak only tells about this search when the search raised it; otherwise the tree at its end is the best sample there is.
+	size_t high = end.PeakResident > start.PeakResident ? end.PeakResident : end.Resident;
+	return high > start.Resident ? high - start.Resident : 0;
 }
 
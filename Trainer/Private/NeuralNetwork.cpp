@@ -1,12 +1,14 @@
 #include "NeuralNetwork.h"
+#include "Random.h"
+#include "Checkpoint.h"
 #include <random>
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 
-NeuralNetwork::NeuralNetwork(int inputSize, const std::vector<int>& hiddenLayers) : Id(NextId++) 
+NeuralNetwork::NeuralNetwork(int inputSize, const std::vector<int>& hiddenLayers) : Id(NextId++), m_version(NextVersion++) 
 {
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937 gen = Random::MakeGenerator(Random::NextTaskSeed(RandomDomain::Network));
     std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
 
     int prevSize = inputSize;
@@ -35,38 +37,43 @@ float NeuralNetwork::Sigmoid(float x) const
 }
 
 
-std::vector<float> NeuralNetwork::FeedForward(const std::vector<float>& input) const 
+float NeuralNetwork::FeedForward(const float* input, int inputSize) const 
 {
-    std::vector<float> layer = input;
-    int wIdx = 0;
+    // The input is read in place; only the hidden activations need buffers. They are kept per thread and only grow,
+    // so evaluations after the first on a thread don't allocate. Search workers evaluate concurrently, hence not members.
+    const float* layer = input;
+    int layerSize = inputSize;
+    thread_local std::vector<float> current;
+    thread_local std::vector<float> next;
 
     for (size_t l = 0; l < m_weights.size() - 1; ++l) 
     {
-        int inputSize = static_cast<int>(layer.size());
         int outputSize = static_cast<int>(m_biases[l].size());
-        std::vector<float> next(outputSize);
+        next.resize(outputSize);
 
         for (int j = 0; j < outputSize; ++j) 
         {
             float sum = m_biases[l][j];
-            int rowOffset = j * inputSize;
-            for (int i = 0; i < inputSize; ++i) 
+            int rowOffset = j * layerSize;
+            for (int i = 0; i < layerSize; ++i) 
             {
                 sum += m_weights[l][rowOffset + i] * layer[i];
             }
             next[j] = Sigmoid(sum);
         }
 
-        layer = next;
+        current.swap(next);
+        layer = current.data();
+        layerSize = outputSize;
     }
 
     float final = m_biases.back()[0];
-    for (int i = 0; i < layer.size(); ++i) 
+    for (int i = 0; i < layerSize; ++i) 
     {
         final += m_weights.back()[i] * layer[i];
     }
 
-    return { Sigmoid(final) };
+    return Sigmoid(final);
 }
 
 void NeuralNetwork::SetKnownEvaluationBounds(float minEval, float maxEval)
@@ -78,7 +85,16 @@ void NeuralNetwork::SetKnownEvaluationBounds(float minEval, float maxEval)
 
 float NeuralNetwork::GetClampedEvaluation(const std::vector<float>& input) const
 {
-    float rawEval = Evaluate(input);
+    return ClampEvaluation(Evaluate(input));
+}
+
+float NeuralNetwork::GetClampedEvaluation(const float* input) const
+{
+    return ClampEvaluation(Evaluate(input));
+}
+
+float NeuralNetwork::ClampEvaluation(float rawEval) const
+{
     if (m_maxEvalKnown == m_minEvalKnown)
     {
         return 0.0f;
@@ -89,13 +105,28 @@ float NeuralNetwork::GetClampedEvaluation(const std::vector<float>& input) const
 
 float NeuralNetwork::Evaluate(const std::vector<float>& input) const 
 {
-    return FeedForward(input)[0];
+    return FeedForward(input.data(), static_cast<int>(input.size()));
+}
+
+float NeuralNetwork::Evaluate(const float* input) const 
+{
+    return FeedForward(input, InputSize());
+}
+
+int NeuralNetwork::InputSize() const
+{
+    // Weights are stored row by row, one row of inputs per neuron of the first layer.
+    return static_cast<int>(m_weights.front().size() / m_biases.front().size());
+}
+
+uint64_t NeuralNetwork::Version() const
+{
+    return m_version;
 }
 
 NeuralNetwork NeuralNetwork::Mutate(int weightRate, int biasRate) const 
 {
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937 gen = Random::MakeGenerator(Random::NextTaskSeed(RandomDomain::Mutation));
     std::normal_distribution<float> noiseDist(0.0f, 1.0f);
 
     NeuralNetwork copy = *this;
@@ -133,6 +164,7 @@ NeuralNetwork NeuralNetwork::Mutate(int weightRate, int biasRate) const
     }
 
     copy.m_clampedEvaluationPossible = false;
+    copy.m_version = NextVersion++;
 
     return copy;
 }
@@ -219,8 +251,57 @@ NeuralNetwork NeuralNetwork::Load(const std::string& filename)
     return nn;
 }
 
+void NeuralNetwork::WriteBinary(std::ostream& out) const
+{
+    Checkpoint::Write(out, Id);
+    Checkpoint::Write(out, static_cast<uint32_t>(m_weights.size()));
+    for (size_t i = 0; i < m_weights.size(); ++i)
+    {
+        Checkpoint::Write(out, static_cast<uint64_t>(m_weights[i].size()));
+        out.write(reinterpret_cast<const char*>(m_weights[i].data()), m_weights[i].size() * sizeof(float));
+        Checkpoint::Write(out, static_cast<uint64_t>(m_biases[i].size()));
+        out.write(reinterpret_cast<const char*>(m_biases[i].data()), m_biases[i].size() * sizeof(float));
+    }
+    Checkpoint::Write(out, m_minEvalKnown);
+    Checkpoint::Write(out, m_maxEvalKnown);
+    Checkpoint::Write(out, m_clampedEvaluationPossible);
+}
+
+NeuralNetwork NeuralNetwork::ReadBinary(std::istream& in)
+{
+    NeuralNetwork nn(0, {});
+    Checkpoint::Read(in, nn.Id);
+
+    uint32_t numLayers = 0;
+    Checkpoint::Read(in, numLayers);
+    nn.m_weights.assign(numLayers, {});
+    nn.m_biases.assign(numLayers, {});
+    for (uint32_t i = 0; i < numLayers && in; ++i)
+    {
+        uint64_t wSize = 0;
+        Checkpoint::Read(in, wSize);
+        nn.m_weights[i].resize(wSize);
+        in.read(reinterpret_cast<char*>(nn.m_weights[i].data()), wSize * sizeof(float));
+
+        uint64_t bSize = 0;
+        Checkpoint::Read(in, bSize);
+        nn.m_biases[i].resize(bSize);
+        in.read(reinterpret_cast<char*>(nn.m_biases[i].data()), bSize * sizeof(float));
+    }
+    Checkpoint::Read(in, nn.m_minEvalKnown);
+    Checkpoint::Read(in, nn.m_maxEvalKnown);
+    Checkpoint::Read(in, nn.m_clampedEvaluationPossible);
+
+    if (!in || numLayers == 0 || nn.m_biases.back().size() != 1)
+    {
+        throw std::runtime_error("Failed to read network.");
+    }
+    return nn;
+}
+
 void NeuralNetwork::GradientDescent(const std::vector<float>& input, float target, float learningRate) 
 {
+    m_version = NextVersion++;
     std::vector<std::vector<float>> activations = { input };
     std::vector<std::vector<float>> zVectors;
 
@@ -291,6 +372,7 @@ void NeuralNetwork::GradientDescent(const std::vector<float>& input, float targe
 
 void NeuralNetwork::TrainSingle(const std::vector<float>& input, float target, float learningRate)
 {
+    m_version = NextVersion++;
     std::vector<std::vector<float>> activations; 
     std::vector<std::vector<float>> zs;          
 
@@ -396,4 +478,5 @@ bool NeuralNetwork::ClampedEvaluationPossible()
 }
 
 
-int NeuralNetwork::NextId = 0;
\ No newline at end of file
+int NeuralNetwork::NextId = 0;
+std::atomic<uint64_t> NeuralNetwork::NextVersion(0);
\ No newline at end of file
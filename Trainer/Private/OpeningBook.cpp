@@ -0,0 +1,250 @@
+#include "OpeningBook.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace
+{
+	const char BookMagic[8] = { 'O', 'B', 'O', 'O', 'K', '0', '0', '1' };
+
+	/// <summary>Raw text of a value in one of the log's JSON lines, without the quotes of strings.</summary>
+	std::string JsonValue(const std::string& line, const std::string& key)
+	{
+		std::string pattern = "\"" + key + "\":";
+		size_t start = line.find(pattern);
+		if (start == std::string::npos)
+		{
+			return "";
+		}
+		start += pattern.size();
+		if (start < line.size() && line[start] == '"')
+		{
+			size_t end = line.find('"', start + 1);
+			return end == std::string::npos ? "" : line.substr(start + 1, end - start - 1);
+		}
+		size_t end = line.find_first_of(",}", start);
+		return end == std::string::npos ? "" : line.substr(start, end - start);
+	}
+
+	struct MoveTotals
+	{
+		uint64_t Visits = 0;
+		uint32_t Games = 0;
+		double ScoreSum = 0.0;
+	};
+
+	struct PositionTotals
+	{
+		uint32_t Games = 0;
+		/// <summary>Earliest ply, for positions reached by move orders of different length.</summary>
+		int Ply = INT32_MAX;
+	};
+}
+
+bool OpeningBook::AppendGame(const std::string& logPath, const std::string& gameName, const std::vector<LoggedPly>& plies, IGame::Winner winner)
+{
+	int result = winner == IGame::Winner::FirstPlayer ? 1 : (winner == IGame::Winner::SecondPlayer ? -1 : 0);
+	std::ostringstream lines;
+	for (const LoggedPly& ply : plies)
+	{
+		lines << "{\"game\":\"" << gameName << "\",\"ply\":" << ply.Ply << ",\"hash\":" << ply.Hash
+			<< ",\"player\":" << ply.Player << ",\"move\":" << ply.Move << ",\"result\":" << result << ",\"visits\":\"";
+		for (size_t i = 0; i < ply.Visits.size(); ++i)
+		{
+			lines << (i > 0 ? " " : "") << ply.Visits[i].first << ":" << ply.Visits[i].second;
+		}
+		lines << "\"}\n";
+	}
+
+	static std::mutex logMutex;
+	std::lock_guard<std::mutex> lock(logMutex);
+	std::ofstream log(logPath, std::ios::app);
+	log << lines.str();
+	return static_cast<bool>(log);
+}
+
+long long OpeningBook::Build(const std::string& logPath, const std::string& gameName, int maxPly, int minGames, const std::string& bookPath)
+{
+	std::ifstream log(logPath);
+	if (!log)
+	{
+		return -1;
+	}
+
+	std::map<std::pair<uint64_t, int>, MoveTotals> totals;
+	std::map<uint64_t, PositionTotals> positions;
+	std::string line;
+	while (std::getline(log, line))
+	{
+		if (JsonValue(line, "game") != gameName)
+		{
+			continue;
+		}
+		int ply = std::atoi(JsonValue(line, "ply").c_str());
+		if (ply >= maxPly)
+		{
+			continue;
+		}
+		uint64_t hash = std::strtoull(JsonValue(line, "hash").c_str(), nullptr, 10);
+		int player = std::atoi(JsonValue(line, "player").c_str());
+		int move = std::atoi(JsonValue(line, "move").c_str());
+		int result = std::atoi(JsonValue(line, "result").c_str());
+
+		MoveTotals& played = totals[{ hash, move }];
+		played.Games++;
+		played.ScoreSum += player == 1 ? result : -result;
+		PositionTotals& position = positions[hash];
+		position.Games++;
+		position.Ply = std::min(position.Ply, ply);
+
+		std::istringstream visits(JsonValue(line, "visits"));
+		std::string pair;
+		while (visits >> pair)
+		{
+			size_t colon = pair.find(':');
+			if (colon == std::string::npos)
+			{
+				continue;
+			}
+			totals[{ hash, std::atoi(pair.substr(0, colon).c_str()) }].Visits += std::strtoull(pair.c_str() + colon + 1, nullptr, 10);
+		}
+	}
+
+	std::vector<Entry> entries;
+	long long positionCount = 0;
+	for (const auto& total : totals)
+	{
+		const PositionTotals& position = positions[total.first.first];
+		if (position.Games < static_cast<uint32_t>(std::max(minGames, 1)))
+		{
+			continue;
+		}
+		if (entries.empty() || entries.back().Hash != total.first.first)
+		{
+			positionCount++;
+		}
+
+		Entry entry = {};
+		entry.Hash = total.first.first;
+		entry.Move = total.first.second;
+		entry.Ply = static_cast<uint16_t>(position.Ply);
+		entry.Visits = total.second.Visits;
+		entry.Games = total.second.Games;
+		entry.Score = total.second.Games > 0 ? static_cast<float>(total.second.ScoreSum / total.second.Games) : 0.0f;
+		entries.push_back(entry);
+	}
+
+	{
+		std::ofstream out(bookPath, std::ios::binary);
+		FileHeader header = {};
+		std::memcpy(header.Magic, BookMagic, sizeof(header.Magic));
+		header.MaxPly = static_cast<uint32_t>(maxPly);
+		header.Count = entries.size();
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+		if (!out)
+		{
+			return -1;
+		}
+	}
+	return positionCount;
+}
+
+bool OpeningBook::Load(const std::string& path)
+{
+	MappedFile file;
+	if (!file.Open(path) || file.Size() < sizeof(FileHeader))
+	{
+		return false;
+	}
+
+	const FileHeader* header = static_cast<const FileHeader*>(file.Data());
+	if (std::memcmp(header->Magic, BookMagic, sizeof(header->Magic)) != 0
+		|| file.Size() != sizeof(FileHeader) + header->Count * sizeof(Entry))
+	{
+		return false;
+	}
+
+	m_file.Swap(file);
+	m_entries = reinterpret_cast<const Entry*>(header + 1);
+	m_count = header->Count;
+	return true;
+}
+
+bool OpeningBook::IsLoaded() const
+{
+	return m_entries != nullptr;
+}
+
+bool OpeningBook::Lookup(const IGame& game, int maxPly, double temperature, std::mt19937& rng, int& move, float& value) const
+{
+	if (!m_entries || game.GetWinner() != IGame::Winner::OnGoing)
+	{
+		return false;
+	}
+
+	uint64_t hash = game.GetHash();
+	const Entry* begin = std::lower_bound(m_entries, m_entries + m_count, hash, [](const Entry& entry, uint64_t key) { return entry.Hash < key; });
+	const Entry* end = begin;
+	while (end != m_entries + m_count && end->Hash == hash)
+	{
+		++end;
+	}
+	if (begin == end || begin->Ply >= maxPly)
+	{
+		return false;
+	}
+
+	// Only legal moves count, so a hash collision can't play an illegal one. Moves never searched fall back to how often they were played.
+	MoveList legal;
+	game.GenerateMoves(legal);
+	std::vector<const Entry*> candidates;
+	bool searched = false;
+	for (const Entry* entry = begin; entry != end; ++entry)
+	{
+		if (std::find(legal.begin(), legal.end(), entry->Move) != legal.end() && (entry->Visits > 0 || entry->Games > 0))
+		{
+			candidates.push_back(entry);
+			searched = searched || entry->Visits > 0;
+		}
+	}
+	if (candidates.empty())
+	{
+		return false;
+	}
+
+	auto weight = [searched](const Entry* entry) { return static_cast<double>(searched ? entry->Visits : entry->Games); };
+	const Entry* chosen = candidates[0];
+	if (temperature <= 0.0)
+	{
+		for (const Entry* candidate : candidates)
+		{
+			chosen = weight(candidate) > weight(chosen) ? candidate : chosen;
+		}
+	}
+	else
+	{
+		double top = 0.0;
+		for (const Entry* candidate : candidates)
+		{
+			top = std::max(top, weight(candidate));
+		}
+		// Relative to the most visited move, so the powers stay in range for small temperatures.
+		std::vector<double> weights;
+		for (const Entry* candidate : candidates)
+		{
+			weights.push_back(std::pow(weight(candidate) / top, 1.0 / temperature));
+		}
+		chosen = candidates[std::discrete_distribution<size_t>(weights.begin(), weights.end())(rng)];
+	}
+
+	move = chosen->Move;
+	value = game.GetCurrentPlayer() == 1 ? chosen->Score : -chosen->Score;
+	return true;
+}
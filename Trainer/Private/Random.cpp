@@ -0,0 +1,70 @@
+#include "Random.h"
+#include <atomic>
+
+namespace
+{
+	const uint64_t GoldenGamma = 0x9E3779B97F4A7C15ull;
+
+	uint64_t DrawEntropySeed()
+	{
+		std::random_device rd;
+		return (static_cast<uint64_t>(rd()) << 32) ^ rd();
+	}
+
+	std::atomic<uint64_t> s_masterSeed{ DrawEntropySeed() };
+	std::atomic<uint64_t> s_taskCounters[static_cast<int>(RandomDomain::Count)];
+}
+
+void Random::SetMasterSeed(uint64_t seed)
+{
+	s_masterSeed = seed;
+	for (auto& counter : s_taskCounters)
+	{
+		counter = 0;
+	}
+}
+
+uint64_t Random::GetMasterSeed()
+{
+	return s_masterSeed;
+}
+
+std::vector<uint64_t> Random::GetTaskCounters()
+{
+	std::vector<uint64_t> counters;
+	for (const auto& counter : s_taskCounters)
+	{
+		counters.push_back(counter);
+	}
+	return counters;
+}
+
+void Random::Restore(uint64_t masterSeed, const std::vector<uint64_t>& taskCounters)
+{
+	SetMasterSeed(masterSeed);
+	for (size_t i = 0; i < taskCounters.size() && i < static_cast<size_t>(RandomDomain::Count); ++i)
+	{
+		s_taskCounters[i] = taskCounters[i];
+	}
+}
+
+uint64_t Random::NextTaskSeed(RandomDomain domain)
+{
+	uint64_t counter = s_taskCounters[static_cast<int>(domain)]++;
+	uint64_t domainKey = Mix((static_cast<uint64_t>(domain) + 1) * GoldenGamma);
+	return Mix(s_masterSeed ^ Mix(domainKey + counter * GoldenGamma));
+}
+
+std::mt19937 Random::MakeGenerator(uint64_t taskSeed, uint64_t stream)
+{
+	uint64_t streamSeed = Mix(taskSeed + (stream + 1) * GoldenGamma);
+	std::seed_seq sequence{ static_cast<uint32_t>(streamSeed), static_cast<uint32_t>(streamSeed >> 32) };
+	return std::mt19937(sequence);
+}
+
+uint64_t Random::Mix(uint64_t value)
+{
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+	return value ^ (value >> 31);
+}
@@ -8,60 +8,17 @@
 #include <limits>
 
 
-void GameSelector::LoadGameDLLs() 
-{
-    char buffer[MAX_PATH];
-    GetModuleFileNameA(NULL, buffer, MAX_PATH);
-    std::string exePath(buffer);
-    size_t lastSlash = exePath.find_last_of("\\/");
-    std::string exeDir = exePath.substr(0, lastSlash);
-
-    std::string dllDir = exeDir + "/";
-    std::string searchPattern = dllDir + "*.dll";
-
-    WIN32_FIND_DATAA findData;
-    HANDLE hFind = FindFirstFileA(searchPattern.c_str(), &findData);
-    if (hFind == INVALID_HANDLE_VALUE)
-    {
-        return;
-    }
-
-    do 
-    {
-        std::string fullPath = dllDir + findData.cFileName;
-        HMODULE lib = LoadLibraryA(fullPath.c_str());
-        if (!lib)
-        {
-            continue;
-        }
-
-        auto getName = (GetGameNameFunc)GetProcAddress(lib, "GetGameName");
-        auto createGame = (CreateGameFunc)GetProcAddress(lib, "CreateGame");
-
-        if (getName && createGame) 
-        {
-            m_loadedGames.push_back({ lib, getName(), createGame });
-        }
-        else 
-        {
-            FreeLibrary(lib);
-        }
-
-    } while (FindNextFileA(hFind, &findData));
-
-    FindClose(hFind);
-}
-
 void GameSelector::Start() 
 {
-    LoadGameDLLs();
+    m_modules.LoadAll();
+    const std::vector<GameModules::Entry>& games = m_modules.Games();
 
     while (true) 
     {
         std::cout << "=== Select a Game ===\n";
-        for (size_t i = 0; i < m_loadedGames.size(); ++i) 
+        for (size_t i = 0; i < games.size(); ++i) 
         {
-            std::cout << i + 1 << ". " << m_loadedGames[i].Name << "\n";
+            std::cout << i + 1 << ". " << games[i].Name << "\n";
         }
         std::cout << "0. Exit\nChoice: ";
 
@@ -80,13 +37,13 @@ void GameSelector::Start()
         {
             return;
         }
-        if (choice < 1 || choice >(int)m_loadedGames.size()) 
+        if (choice < 1 || choice >(int)games.size()) 
         {
             std::cout << "Invalid choice.\n";
             continue;
         }
 
-        auto& gameEntry = m_loadedGames[choice - 1];
+        auto& gameEntry = games[choice - 1];
 
         int mode = -1;
         while (true) 
@@ -125,7 +82,9 @@ void GameSelector::Start()
 
         case 2: 
         {
-            Trainer train(game->Clone());
+            std::unique_ptr<SimulationEngine> engine(gameEntry.CreateEngineFunc ? gameEntry.CreateEngineFunc() : nullptr);
+            std::unique_ptr<GameOracle> oracle(gameEntry.CreateOracleFunc ? gameEntry.CreateOracleFunc() : nullptr);
+            Trainer train(game->Clone(), std::move(engine), std::move(oracle));
             train.Run();
             break;
         }
@@ -163,8 +122,15 @@ void GameSelector::PlayGameLoop(std::unique_ptr<IGame> game, NeuralNetwork* aiNe
 
                 if (aiNetwork && current != humanPlayer) 
                 {
-                    int bestMove = MonteCarlo::MonteCarloTreeSearch(*game, 3.0f, aiNetwork);
-                    game->MakeMove(bestMove);
+                    MonteCarlo::EvaluationAndMove result = MonteCarlo::MonteCarloTreeSearch(*game, 3.0f, aiNetwork);
+                    std::cout << "Search tree peak: " << result.Memory.PeakNodes << " nodes ("
+                        << result.Memory.PeakTreeBytes / (1024 * 1024) << " MB), process growth: "
+                        << result.Memory.ProcessGrowthBytes / (1024 * 1024) << " MB\n";
+                    std::cout << "Search: " << result.Stats.Iterations << " iterations ("
+                        << static_cast<long long>(result.Stats.IterationsPerSecond()) << "/s), depth avg "
+                        << result.Stats.AverageDepth() << " max " << result.Stats.MaxDepth
+                        << ", lock wait " << result.Stats.LockWaitSeconds << " s\n";
+                    game->MakeMove(result.Move);
                     graphics->SubmitEntitiesFromGrid(game->GetSpriteGrid());
                 }
 
@@ -5,20 +5,75 @@
 #include <random>
 #include <limits>
 #include "MonteCarlo.h"
-#define NOMINMAX
-#include <windows.h>
+#include "Random.h"
+#include "Benchmark.h"
 #include <numeric>
 #include <algorithm>
+#ifndef TRAINER_HEADLESS
 #include "Selector.h"
+#endif
 #include <thread>
+#ifdef _WIN32
 #include <conio.h>
+#endif
 #include <mutex>
 #include <unordered_set>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <filesystem>
+#include <system_error>
+
+namespace
+{
+    const char CheckpointMagic[8] = { 'C', 'K', 'P', 'T', '0', '0', '0', '1' };
 
-Trainer::Trainer(std::unique_ptr<IGame> baseGame)
-    : m_baseGame(std::move(baseGame)), m_championImprovements(0)
+    /// <summary>The text as a quoted JSON string.</summary>
+    std::string JsonString(const std::string& text)
+    {
+        std::string quoted = "\"";
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                quoted += '\\';
+                quoted += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                quoted += escaped;
+            }
+            else
+            {
+                quoted += c;
+            }
+        }
+        return quoted + "\"";
+    }
+
+    /// <summary>Scores the candidate moves of the engine's match loops with a network.</summary>
+    class NetworkScorer final : public StateScorer
+    {
+    public:
+        explicit NetworkScorer(const NeuralNetwork* network) : m_network(network) {}
+        float Score(const float* state) const { return m_network->Evaluate(state); }
+    private:
+        const NeuralNetwork* m_network;
+    };
+}
+
+Trainer::Trainer(std::unique_ptr<IGame> baseGame, std::unique_ptr<SimulationEngine> engine, std::unique_ptr<GameOracle> oracle)
+    : m_baseGame(std::move(baseGame)), m_simulationEngine(std::move(engine)), m_oracle(std::move(oracle))
 {
-    ;
+    m_searchSettings.Engine = m_simulationEngine.get();
+}
+
+const SimulationEngine& Trainer::Engine() const
+{
+    return m_simulationEngine ? *m_simulationEngine : SimulationEngine::ThroughInterface();
 }
 
 
@@ -46,7 +101,7 @@ void Trainer::Run()
     {
         m_population.emplace_back(Player{
             std::make_unique<NeuralNetwork>(
-                m_baseGame->GetBoardState().size(),
+                m_baseGame->StateSize(),
                 layerSizes
             ), 0
             });
@@ -64,6 +119,17 @@ void Trainer::Run()
         std::cout << "7. Train N iterations with PPO\n";
         std::cout << "8. Load Neural network\n";
         std::cout << "9. Fuzz extremes\n";
+        std::cout << "10. Benchmark move generation (perft)\n";
+        std::cout << "11. Check position hashes and undo\n";
+        if (m_oracle)
+        {
+            std::cout << "12. Test champion vs the game's solver (100 games)\n";
+            std::cout << "13. Build solver database\n";
+            std::cout << "14. Load solver database\n";
+            std::cout << "15. Benchmark solver probes\n";
+        }
+        std::cout << "16. Build opening book from self-play log\n";
+        std::cout << "17. Resume training from checkpoint\n";
         std::cout << "0. Exit\n";
         std::cout << "Choice: ";
 
@@ -108,7 +174,11 @@ void Trainer::Run()
 
             std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 
+#ifdef TRAINER_HEADLESS
+            std::cout << "Playing needs the graphical build.\n";
+#else
             GameSelector::PlayGameLoop(m_baseGame->Clone(), GetChampion(), userPlayer);
+#endif
             break;
         }
         case 2: {
@@ -138,7 +208,7 @@ void Trainer::Run()
             break;
         }
         case 4:
-            TestChampionAgainstRandom(100);
+            TestChampion(100);
             break;
         case 5:
             std::cout << "Train against random agent only. Enter iterations: ";
@@ -222,6 +292,156 @@ void Trainer::Run()
             std::cout << "Clamping range updated to [" << minEval << ", " << maxEval << "]\n";
             break;
         }
+        case 10:
+        {
+            std::cout << "Enter perft depth: ";
+            int depth;
+            std::cin >> depth;
+            if (!std::cin.fail() && depth > 0)
+            {
+                Benchmark::RunPerft(*m_baseGame, depth, m_simulationEngine.get());
+                if (m_simulationEngine)
+                {
+                    Benchmark::RunSearchComparison(*m_baseGame, *m_simulationEngine, 20000);
+                }
+            }
+            else
+            {
+                std::cout << "Invalid number.\n";
+            }
+            break;
+        }
+        case 11:
+        {
+            std::cout << "Enter number of random games: ";
+            int games;
+            std::cin >> games;
+            if (!std::cin.fail() && games > 0)
+            {
+                Benchmark::RunHashCheck(*m_baseGame, games);
+                Benchmark::RunUndoCheck(*m_baseGame, games);
+            }
+            else
+            {
+                std::cout << "Invalid number.\n";
+            }
+            break;
+        }
+        case 12:
+        {
+            if (!m_oracle)
+            {
+                std::cout << "Invalid choice.\n";
+                break;
+            }
+            TestChampion(100, m_oracle.get());
+            break;
+        }
+        case 13:
+        {
+            if (!m_oracle)
+            {
+                std::cout << "Invalid choice.\n";
+                break;
+            }
+            std::cout << "Enter database file name: ";
+            std::string path;
+            std::cin >> path;
+            std::cout << "Enter database size (Connect Four: moves from the start, Checkers: pieces on the board): ";
+            int size;
+            std::cin >> size;
+            if (!std::cin.fail() && size >= 0)
+            {
+                std::cout << (m_oracle->BuildDatabase(path, size) ? "Database written.\n" : "Failed to write database.\n");
+            }
+            else
+            {
+                std::cout << "Invalid number.\n";
+            }
+            break;
+        }
+        case 14:
+        {
+            if (!m_oracle)
+            {
+                std::cout << "Invalid choice.\n";
+                break;
+            }
+            std::cout << "Enter database file name: ";
+            std::string path;
+            std::cin >> path;
+            if (!std::cin.fail())
+            {
+                std::cout << (m_oracle->LoadDatabase(path) ? "Database loaded.\n" : "Failed to load database.\n");
+            }
+            break;
+        }
+        case 15:
+        {
+            if (!m_oracle)
+            {
+                std::cout << "Invalid choice.\n";
+                break;
+            }
+            std::cout << "Enter number of random games: ";
+            int games;
+            std::cin >> games;
+            if (!std::cin.fail() && games > 0)
+            {
+                Benchmark::RunOracleBenchmark(*m_baseGame, *m_oracle, games);
+            }
+            else
+            {
+                std::cout << "Invalid number.\n";
+            }
+            break;
+        }
+        case 16:
+        {
+            std::cout << "Enter self-play log file: ";
+            std::string logPath;
+            std::cin >> logPath;
+            std::cout << "Enter opening book file to write: ";
+            std::string bookPath;
+            std::cin >> bookPath;
+            std::cout << "Enter book depth in plies: ";
+            int plies;
+            std::cin >> plies;
+            std::cout << "Enter minimum games per position: ";
+            int minGames;
+            std::cin >> minGames;
+            if (std::cin.fail() || plies <= 0 || minGames <= 0)
+            {
+                std::cout << "Invalid number.\n";
+                break;
+            }
+
+            long long positions = OpeningBook::Build(logPath, m_baseGame->GetName(), plies, minGames, bookPath);
+            if (positions < 0)
+            {
+                std::cout << "Failed to build opening book.\n";
+            }
+            else
+            {
+                std::cout << "Opening book with " << positions << " positions written.\n";
+            }
+            break;
+        }
+        case 17:
+        {
+            std::cout << "Enter checkpoint file: ";
+            std::string path;
+            std::cin >> path;
+            if (!std::cin.fail())
+            {
+                ResumeTraining(path);
+            }
+            else
+            {
+                std::cout << "Failed to read name.\n";
+            }
+            break;
+        }
         case 0:
             return;
         default:
@@ -233,11 +453,13 @@ void Trainer::Run()
 
 void Trainer::FuzzEvaluationExtremes(const IGame& baseGame, NeuralNetwork* network, int nGames, float& outMinEval, float& outMaxEval, bool log)
 {
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937 gen = Random::MakeGenerator(Random::NextTaskSeed(RandomDomain::Fuzzing));
 
     outMinEval = std::numeric_limits<float>::max();
     outMaxEval = std::numeric_limits<float>::lowest();
+    // Random games rarely meet a position twice, and the network is usually about to change (PPO updates it right
+    // before fuzzing), so these evaluations bypass the cache instead of evicting entries the search still uses.
+    std::vector<float> input(baseGame.StateSize());
 
     for (int i = 0; i < nGames; ++i) 
     {
@@ -245,18 +467,19 @@ void Trainer::FuzzEvaluationExtremes(const IGame& baseGame, NeuralNetwork* netwo
 
         while (game->GetWinner() == IGame::Winner::OnGoing) 
         {
-            auto valid = game->GetValidMoves();
-            if (valid.empty())
+            MoveList valid;
+            if (game->GenerateMoves(valid) == 0)
             {
                 break;
             }
 
-            std::uniform_int_distribution<> randMove(0, static_cast<int>(valid.size()) - 1);
+            std::uniform_int_distribution<> randMove(0, valid.Count - 1);
             int move = valid[randMove(gen)];
 
             game->MakeMove(move);
 
-            float eval = network->Evaluate(game->GetBoardState());
+            game->EncodeState(input.data());
+            float eval = network->Evaluate(input.data());
 
             if (eval < outMinEval) outMinEval = eval;
             if (eval > outMaxEval) outMaxEval = eval;
@@ -275,10 +498,9 @@ void Trainer::ListSaves(IGame* game)
     std::string prefix = game->GetName();
     std::string suffix = ".nn";
 
-    WIN32_FIND_DATAA findData;
-    HANDLE hFind = FindFirstFileA("./*", &findData);
-
-    if (hFind == INVALID_HANDLE_VALUE) 
+    std::error_code error;
+    std::filesystem::directory_iterator directory(".", error);
+    if (error) 
     {
         std::cerr << "Error opening directory.\n";
         return;
@@ -286,10 +508,10 @@ void Trainer::ListSaves(IGame* game)
 
     std::vector<std::string> matchedFiles;
 
-    do 
+    for (const auto& entry : directory) 
     {
-        std::string fileName = findData.cFileName;
-        if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) 
+        std::string fileName = entry.path().filename().string();
+        if (!entry.is_directory(error)) 
         {
             if (fileName.size() >= prefix.size() + suffix.size() &&
                 fileName.substr(0, prefix.size()) == prefix &&
@@ -298,9 +520,8 @@ void Trainer::ListSaves(IGame* game)
                 matchedFiles.push_back(fileName);
             }
         }
-    } while (FindNextFileA(hFind, &findData));
-
-    FindClose(hFind);
+    }
+    std::sort(matchedFiles.begin(), matchedFiles.end());
 
     if (matchedFiles.empty())
     {
@@ -327,6 +548,31 @@ void Trainer::ChangeParametersMenu()
         std::cout << "4. Learning rate (current: " << m_learningRate << ")\n";
         std::cout << "5. MCTS episodes (current: " << m_MCTSEpisodes << ")\n";
         std::cout << "6 Epsilon (current: " << m_epsilon << ")\n";
+        std::cout << "7. RAVE in MCTS (current: " << (m_searchSettings.UseRave ? "on" : "off")
+            << ", equivalence: " << m_searchSettings.RaveEquivalence << ")\n";
+        std::cout << "8. MCTS random playout weight (current: " << m_playoutLambda << ")\n";
+        std::cout << "9. MCTS tree memory limit in MB (current: " << m_searchSettings.MaxTreeBytes / (1024 * 1024)
+            << (m_searchSettings.OnMemoryLimit == MemoryLimitPolicy::RecycleSubtrees ? ", recycle subtrees" : ", stop expanding") << ")\n";
+        std::cout << "10. MCTS statistics log file (current: "
+            << (m_searchSettings.StatsLogPath.empty() ? "off" : m_searchSettings.StatsLogPath) << ")\n";
+        std::cout << "11. Random seed (current: " << Random::GetMasterSeed() << ")\n";
+        std::cout << "12. Deterministic MCTS (current: "
+            << (m_searchSettings.Deterministic ? "on, batch " + std::to_string(m_searchSettings.DeterministicBatchSize) : "off") << ")\n";
+        std::cout << "13. Train on symmetric positions (current: " << (m_augmentSymmetries ? "on" : "off") << ")\n";
+        std::cout << "14. Evaluation cache size in MB (current: " << m_evaluationCache.MemoryBytes() / (1024 * 1024)
+            << ", hit rate " << m_evaluationCache.HitRate() * 100.0 << "% of " << m_evaluationCache.Hits() + m_evaluationCache.Misses() << " lookups)\n";
+        if (m_oracle)
+        {
+            std::cout << "15. Exact values from the game's solver (current: "
+                << (m_useOracle ? "on, probe limit " + std::to_string(m_oracle->GetProbeLimit()) : "off") << ")\n";
+        }
+        std::cout << "16. Opening book (current: " << (m_searchSettings.Book ? m_openingBookPath + ", " + std::to_string(m_searchSettings.BookMaxPly)
+            + " plies, temperature " + std::to_string(m_searchSettings.BookTemperature) : "off") << ")\n";
+        std::cout << "17. Self-play log for opening books (current: "
+            << (m_selfPlayLogPath.empty() ? "off" : m_selfPlayLogPath + ", " + std::to_string(m_selfPlayLogPlies) + " plies") << ")\n";
+        std::cout << "18. Training checkpoints (current: "
+            << (m_checkpointPath.empty() ? "off" : m_checkpointPath + ", every " + std::to_string(m_checkpointInterval) + " generations") << ")\n";
+        std::cout << "19. Threads for matches and searches (current: " << (m_threads > 0 ? std::to_string(m_threads) : "all cores") << ")\n";
         std::cout << "0. Exit\n";
         std::cout << "Choice: ";
 
@@ -373,7 +619,7 @@ void Trainer::ChangeParametersMenu()
                     while (static_cast<int>(m_population.size()) < newSize)
                     {
                         m_population.emplace_back(Player{ std::make_unique<NeuralNetwork>(
-                            this->m_baseGame->GetBoardState().size(),
+                            this->m_baseGame->StateSize(),
                             std::vector<int>{42, 42, 21, 8} //TODO: fix - remove hardcoded weights
                             ), 0 });
                     }
@@ -447,6 +693,279 @@ void Trainer::ChangeParametersMenu()
             }
             break;
         }
+        case 7:
+        {
+            std::cout << "Enter RAVE equivalence visits (0 disables RAVE): ";
+            float newEquivalence;
+            std::cin >> newEquivalence;
+            if (!std::cin.fail() && newEquivalence >= 0)
+            {
+                m_searchSettings.UseRave = newEquivalence > 0;
+                if (m_searchSettings.UseRave)
+                {
+                    m_searchSettings.RaveEquivalence = newEquivalence;
+                }
+            }
+            else
+            {
+                std::cout << "Invalid number.\n";
+            }
+            break;
+        }
+        case 8:
+        {
+            std::cout << "Enter playout weight (0 = network only, 1 = random playouts only): ";
+            float newLambda;
+            std::cin >> newLambda;
+            if (!std::cin.fail() && newLambda >= 0 && newLambda <= 1)
+            {
+                m_playoutLambda = newLambda;
+            }
+            else
+            {
+                std::cout << "Invalid number.\n";
+            }
+            break;
+        }
+        case 9:
+        {
+            std::cout << "Enter tree memory limit in MB (0 for unlimited): ";
+            int newLimit;
+            std::cin >> newLimit;
+            if (std::cin.fail() || newLimit < 0)
+            {
+                std::cout << "Invalid number.\n";
+                break;
+            }
+            m_searchSettings.MaxTreeBytes = static_cast<size_t>(newLimit) * 1024 * 1024;
+            if (newLimit == 0)
+            {
+                break;
+            }
+
+            std::cout << "When the limit is reached: 1. Stop expanding 2. Recycle least visited subtrees: ";
+            int policy;
+            std::cin >> policy;
+            if (!std::cin.fail() && (policy == 1 || policy == 2))
+            {
+                m_searchSettings.OnMemoryLimit = policy == 1 ? MemoryLimitPolicy::StopExpanding : MemoryLimitPolicy::RecycleSubtrees;
+            }
+            else
+            {
+                std::cout << "Invalid choice.\n";
+            }
+            break;
+        }
+        case 10:
+        {
+            std::cout << "Enter file to append search statistics to as JSON lines (- to disable): ";
+            std::string path;
+            std::cin >> path;
+            if (!std::cin.fail())
+            {
+                m_searchSettings.StatsLogPath = path == "-" ? "" : path;
+            }
+            else
+            {
+                std::cout << "Failed to read name.\n";
+            }
+            break;
+        }
+        case 11:
+        {
+            std::cout << "Enter new random seed: ";
+            uint64_t newSeed;
+            std::cin >> newSeed;
+            if (!std::cin.fail())
+            {
+                Random::SetMasterSeed(newSeed);
+            }
+            else
+            {
+                std::cout << "Invalid number.\n";
+            }
+            break;
+        }
+        case 12:
+        {
+            std::cout << "Enter leaves per deterministic MCTS round (0 to disable): ";
+            int newBatchSize;
+            std::cin >> newBatchSize;
+            if (!std::cin.fail() && newBatchSize >= 0)
+            {
+                m_searchSettings.Deterministic = newBatchSize > 0;
+                if (m_searchSettings.Deterministic)
+                {
+                    m_searchSettings.DeterministicBatchSize = newBatchSize;
+                }
+            }
+            else
+            {
+                std::cout << "Invalid number.\n";
+            }
+            break;
+        }
+        case 13:
+        {
+            m_augmentSymmetries = !m_augmentSymmetries;
+            std::cout << "Symmetric training positions " << (m_augmentSymmetries ? "enabled" : "disabled") << ".\n";
+            break;
+        }
+        case 14:
+        {
+            std::cout << "Enter evaluation cache size in MB: ";
+            size_t megabytes;
+            std::cin >> megabytes;
+            if (!std::cin.fail() && megabytes > 0)
+            {
+                m_evaluationCache.Resize(megabytes * 1024 * 1024);
+            }
+            else
+            {
+                std::cout << "Invalid number.\n";
+            }
+            break;
+        }
+        case 15:
+        {
+            if (!m_oracle)
+            {
+                std::cout << "Invalid choice.\n";
+                break;
+            }
+            std::cout << "Enter solver probe limit (negative to disable exact values): ";
+            int limit;
+            std::cin >> limit;
+            if (!std::cin.fail())
+            {
+                m_useOracle = limit >= 0;
+                if (m_useOracle)
+                {
+                    m_oracle->SetProbeLimit(limit);
+                }
+            }
+            else
+            {
+                std::cout << "Invalid number.\n";
+            }
+            break;
+        }
+        case 16:
+        {
+            std::cout << "Enter opening book file (- to disable): ";
+            std::string path;
+            std::cin >> path;
+            if (std::cin.fail())
+            {
+                std::cout << "Failed to read name.\n";
+                break;
+            }
+            m_searchSettings.Book = nullptr;
+            if (path == "-")
+            {
+                break;
+            }
+            if (!m_openingBook.Load(path))
+            {
+                std::cout << "Failed to load opening book.\n";
+                break;
+            }
+
+            std::cout << "Enter book depth in plies: ";
+            int plies;
+            std::cin >> plies;
+            std::cout << "Enter book temperature (0 always plays the most visited move): ";
+            double temperature;
+            std::cin >> temperature;
+            if (!std::cin.fail() && plies > 0 && temperature >= 0.0)
+            {
+                m_openingBookPath = path;
+                m_searchSettings.Book = &m_openingBook;
+                m_searchSettings.BookMaxPly = plies;
+                m_searchSettings.BookTemperature = temperature;
+            }
+            else
+            {
+                std::cout << "Invalid number.\n";
+            }
+            break;
+        }
+        case 17:
+        {
+            std::cout << "Enter file to append self-play opening plies to as JSON lines (- to disable): ";
+            std::string path;
+            std::cin >> path;
+            if (std::cin.fail())
+            {
+                std::cout << "Failed to read name.\n";
+                break;
+            }
+            if (path == "-")
+            {
+                m_selfPlayLogPath.clear();
+                break;
+            }
+
+            std::cout << "Enter plies to log per game: ";
+            int plies;
+            std::cin >> plies;
+            if (!std::cin.fail() && plies > 0)
+            {
+                m_selfPlayLogPath = path;
+                m_selfPlayLogPlies = plies;
+            }
+            else
+            {
+                std::cout << "Invalid number.\n";
+            }
+            break;
+        }
+        case 18:
+        {
+            std::cout << "Enter checkpoint file to save training to (- to disable): ";
+            std::string path;
+            std::cin >> path;
+            if (std::cin.fail())
+            {
+                std::cout << "Failed to read name.\n";
+                break;
+            }
+            if (path == "-")
+            {
+                m_checkpointPath.clear();
+                break;
+            }
+
+            std::cout << "Enter generations between checkpoints: ";
+            int interval;
+            std::cin >> interval;
+            if (!std::cin.fail() && interval > 0)
+            {
+                m_checkpointPath = path;
+                m_checkpointInterval = interval;
+            }
+            else
+            {
+                std::cout << "Invalid number.\n";
+            }
+            break;
+        }
+        case 19:
+        {
+            std::cout << "Enter number of threads (0 for one per core): ";
+            int threads;
+            std::cin >> threads;
+            if (!std::cin.fail() && threads >= 0)
+            {
+                m_threads = threads;
+                m_searchSettings.Threads = static_cast<unsigned int>(threads);
+            }
+            else
+            {
+                std::cout << "Invalid number.\n";
+            }
+            break;
+        }
         case 0:
             return;
         default:
@@ -458,50 +977,461 @@ void Trainer::ChangeParametersMenu()
 
 void Trainer::TrainIterations(int generations) 
 {
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    StartRun(TrainingMode::Evolution, generations);
+    ContinueIterations();
+}
+
+void Trainer::StartRun(TrainingMode mode, int generations)
+{
+    m_run.Mode = mode;
+    m_run.Generation = 0;
+    m_run.Generations = generations;
+    m_run.Generator = Random::MakeGenerator(Random::NextTaskSeed(RandomDomain::Training));
+}
 
-    for (int genIndex = 0; genIndex < generations; ++genIndex) 
+void Trainer::FinishGeneration()
+{
+    ++m_run.Generation;
+    if (m_progress)
+    {
+        *m_progress << "{\"event\":\"generation\",\"generation\":" << m_run.Generation << ",\"generations\":" << m_run.Generations
+            << ",\"champion\":" << m_championId << ",\"championImprovements\":" << m_championImprovements
+            << ",\"seconds\":" << std::chrono::duration<double>(std::chrono::steady_clock::now() - m_progressStart).count() << "}" << std::endl;
+    }
+    if (m_checkpointPath.empty() || (m_run.Generation % m_checkpointInterval != 0 && m_run.Generation != m_run.Generations))
     {
+        return;
+    }
+    if (!m_checkpoint.Wait())
+    {
+        std::cout << "Failed to write checkpoint " << m_checkpointPath << ".\n";
+    }
+    m_checkpoint.SaveAsync(m_checkpointPath, SerializeCheckpoint());
+    if (m_progress)
+    {
+        *m_progress << "{\"event\":\"checkpoint\",\"generation\":" << m_run.Generation << ",\"path\":" << JsonString(m_checkpointPath) << "}" << std::endl;
+    }
+}
+
+std::string Trainer::SerializeCheckpoint() const
+{
+    std::ostringstream out(std::ios::binary);
+    out.write(CheckpointMagic, sizeof(CheckpointMagic));
+    Checkpoint::WriteString(out, m_baseGame->GetName());
+
+    Checkpoint::Write(out, Random::GetMasterSeed());
+    std::vector<uint64_t> counters = Random::GetTaskCounters();
+    Checkpoint::Write(out, static_cast<uint32_t>(counters.size()));
+    for (uint64_t counter : counters)
+    {
+        Checkpoint::Write(out, counter);
+    }
+    Checkpoint::Write(out, NeuralNetwork::NextId);
+
+    Checkpoint::Write(out, m_populationSize);
+    Checkpoint::Write(out, m_matchesPerIteration);
+    Checkpoint::Write(out, m_mutationRate);
+    Checkpoint::Write(out, m_learningRate);
+    Checkpoint::Write(out, m_epsilon);
+    Checkpoint::Write(out, m_MCTSEpisodes);
+    Checkpoint::Write(out, m_playoutLambda);
+    Checkpoint::Write(out, m_augmentSymmetries);
+    Checkpoint::Write(out, m_useOracle);
+    Checkpoint::Write(out, m_oracle ? m_oracle->GetProbeLimit() : 0);
+    Checkpoint::Write(out, m_searchSettings.UseRave);
+    Checkpoint::Write(out, m_searchSettings.RaveEquivalence);
+    Checkpoint::Write(out, static_cast<uint64_t>(m_searchSettings.MaxTreeBytes));
+    Checkpoint::Write(out, m_searchSettings.OnMemoryLimit);
+    Checkpoint::Write(out, m_searchSettings.Deterministic);
+    Checkpoint::Write(out, m_searchSettings.DeterministicBatchSize);
+    Checkpoint::WriteString(out, m_searchSettings.Book ? m_openingBookPath : "");
+    Checkpoint::Write(out, m_searchSettings.BookMaxPly);
+    Checkpoint::Write(out, m_searchSettings.BookTemperature);
+    Checkpoint::WriteString(out, m_selfPlayLogPath);
+    Checkpoint::Write(out, m_selfPlayLogPlies);
+
+    Checkpoint::Write(out, m_run.Mode);
+    Checkpoint::Write(out, m_run.Generation);
+    Checkpoint::Write(out, m_run.Generations);
+    std::ostringstream generator;
+    generator << m_run.Generator;
+    Checkpoint::WriteString(out, generator.str());
+
+    Checkpoint::Write(out, m_championId);
+    Checkpoint::Write(out, m_championImprovements);
+    Checkpoint::Write(out, static_cast<uint32_t>(m_population.size()));
+    for (const Player& player : m_population)
+    {
+        Checkpoint::Write(out, player.Wins);
+        Checkpoint::Write(out, player.Losses);
+        player.NN->WriteBinary(out);
+    }
+    return out.str();
+}
+
+bool Trainer::RestoreCheckpoint(const std::string& bytes)
+{
+    // Reading networks draws ids and network seeds, so those are put back whenever the checkpoint is refused.
+    uint64_t previousSeed = Random::GetMasterSeed();
+    std::vector<uint64_t> previousCounters = Random::GetTaskCounters();
+    int previousNextId = NeuralNetwork::NextId;
+    auto refuse = [&]()
+    {
+        Random::Restore(previousSeed, previousCounters);
+        NeuralNetwork::NextId = previousNextId;
+        return false;
+    };
+
+    std::istringstream in(bytes, std::ios::binary);
+    char magic[sizeof(CheckpointMagic)] = {};
+    in.read(magic, sizeof(magic));
+    std::string gameName;
+    Checkpoint::ReadString(in, gameName);
+    if (!in || std::memcmp(magic, CheckpointMagic, sizeof(magic)) != 0 || gameName != m_baseGame->GetName())
+    {
+        return refuse();
+    }
+
+    // Everything is read into copies first, so a damaged file changes nothing.
+    uint64_t masterSeed = 0;
+    uint32_t counterCount = 0;
+    Checkpoint::Read(in, masterSeed);
+    Checkpoint::Read(in, counterCount);
+    std::vector<uint64_t> counters(std::min<uint32_t>(counterCount, static_cast<uint32_t>(RandomDomain::Count)));
+    for (uint32_t i = 0; i < counterCount && in; ++i)
+    {
+        uint64_t counter = 0;
+        Checkpoint::Read(in, counter);
+        if (i < counters.size())
+        {
+            counters[i] = counter;
+        }
+    }
+    int nextId = 0;
+    Checkpoint::Read(in, nextId);
+
+    int populationSize = 0, matchesPerIteration = 0, mutationRate = 0, episodes = 0, probeLimit = 0;
+    float learningRate = 0.0f, epsilon = 0.0f, playoutLambda = 0.0f;
+    bool augmentSymmetries = false, useOracle = false;
+    SearchSettings searchSettings = m_searchSettings;
+    uint64_t maxTreeBytes = 0;
+    Checkpoint::Read(in, populationSize);
+    Checkpoint::Read(in, matchesPerIteration);
+    Checkpoint::Read(in, mutationRate);
+    Checkpoint::Read(in, learningRate);
+    Checkpoint::Read(in, epsilon);
+    Checkpoint::Read(in, episodes);
+    Checkpoint::Read(in, playoutLambda);
+    Checkpoint::Read(in, augmentSymmetries);
+    Checkpoint::Read(in, useOracle);
+    Checkpoint::Read(in, probeLimit);
+    Checkpoint::Read(in, searchSettings.UseRave);
+    Checkpoint::Read(in, searchSettings.RaveEquivalence);
+    Checkpoint::Read(in, maxTreeBytes);
+    Checkpoint::Read(in, searchSettings.OnMemoryLimit);
+    Checkpoint::Read(in, searchSettings.Deterministic);
+    Checkpoint::Read(in, searchSettings.DeterministicBatchSize);
+    searchSettings.MaxTreeBytes = static_cast<size_t>(maxTreeBytes);
+    std::string bookPath, selfPlayLogPath;
+    int selfPlayLogPlies = 0;
+    Checkpoint::ReadString(in, bookPath);
+    Checkpoint::Read(in, searchSettings.BookMaxPly);
+    Checkpoint::Read(in, searchSettings.BookTemperature);
+    Checkpoint::ReadString(in, selfPlayLogPath);
+    Checkpoint::Read(in, selfPlayLogPlies);
+
+    TrainingRun run;
+    std::string generator;
+    Checkpoint::Read(in, run.Mode);
+    Checkpoint::Read(in, run.Generation);
+    Checkpoint::Read(in, run.Generations);
+    Checkpoint::ReadString(in, generator);
+    std::istringstream generatorText(generator);
+    generatorText >> run.Generator;
+
+    int championId = -1, championImprovements = 0;
+    uint32_t playerCount = 0;
+    Checkpoint::Read(in, championId);
+    Checkpoint::Read(in, championImprovements);
+    Checkpoint::Read(in, playerCount);
+    if (!in || !generatorText || populationSize < 2 || static_cast<int>(playerCount) != populationSize)
+    {
+        return refuse();
+    }
+
+    std::vector<Player> population;
+    try
+    {
+        for (uint32_t i = 0; i < playerCount; ++i)
+        {
+            Player player;
+            Checkpoint::Read(in, player.Wins);
+            Checkpoint::Read(in, player.Losses);
+            player.NN = std::make_unique<NeuralNetwork>(NeuralNetwork::ReadBinary(in));
+            if (player.NN->InputSize() != m_baseGame->StateSize())
+            {
+                return refuse();
+            }
+            population.push_back(std::move(player));
+        }
+    }
+    catch (...)
+    {
+        return refuse();
+    }
+
+    // The run played its book moves from this book, so it has to be there to continue the same way.
+    if (!bookPath.empty() && !(m_searchSettings.Book && m_openingBookPath == bookPath) && !m_openingBook.Load(bookPath))
+    {
+        return refuse();
+    }
+    searchSettings.Book = bookPath.empty() ? nullptr : &m_openingBook;
+
+    Random::Restore(masterSeed, counters);
+    NeuralNetwork::NextId = nextId;
+    m_populationSize = populationSize;
+    m_matchesPerIteration = matchesPerIteration;
+    m_mutationRate = mutationRate;
+    m_learningRate = learningRate;
+    m_epsilon = epsilon;
+    m_MCTSEpisodes = episodes;
+    m_playoutLambda = playoutLambda;
+    m_augmentSymmetries = augmentSymmetries;
+    m_useOracle = useOracle && m_oracle;
+    if (m_oracle)
+    {
+        m_oracle->SetProbeLimit(probeLimit);
+    }
+    m_searchSettings = searchSettings;
+    m_openingBookPath = bookPath.empty() ? m_openingBookPath : bookPath;
+    m_selfPlayLogPath = selfPlayLogPath;
+    m_selfPlayLogPlies = selfPlayLogPlies;
+    m_run = run;
+    m_championId = championId;
+    m_championImprovements = championImprovements;
+    m_population = std::move(population);
+    return true;
+}
+
+void Trainer::ResumeTraining(const std::string& path)
+{
+    std::string bytes;
+    if (!Checkpoint::Load(path, bytes) || !RestoreCheckpoint(bytes))
+    {
+        std::cout << "Failed to load checkpoint " << path << ".\n";
+        return;
+    }
+    if (m_run.Mode == TrainingMode::None || m_run.Generation >= m_run.Generations)
+    {
+        std::cout << "Checkpoint restored. Its training run had finished.\n";
+        return;
+    }
+
+    std::cout << "Checkpoint restored. Continuing at generation " << m_run.Generation << " of " << m_run.Generations << ".\n";
+    ContinueRun();
+}
+
+void Trainer::ContinueRun()
+{
+    switch (m_run.Mode)
+    {
+    case TrainingMode::Evolution:
+        ContinueIterations();
+        break;
+    case TrainingMode::AgainstRandom:
+        ContinueIterationsAgainstRandom();
+        break;
+    case TrainingMode::PPO:
+        ContinueIterationsPPO();
+        break;
+    default:
+        break;
+    }
+}
+
+int Trainer::RunHeadless(const TrainingConfig& config)
+{
+    // Stdout carries only the progress lines; what the training loops print for people goes to stderr.
+    std::ostream progress(std::cout.rdbuf());
+    std::streambuf* consoleBuffer = std::cout.rdbuf(std::cerr.rdbuf());
+    m_progress = &progress;
+    m_progressStart = std::chrono::steady_clock::now();
+    auto finish = [&](int exitCode, const std::string& error)
+    {
+        if (!error.empty())
+        {
+            progress << "{\"event\":\"error\",\"message\":" << JsonString(error) << "}" << std::endl;
+        }
+        m_progress = nullptr;
+        std::cout.rdbuf(consoleBuffer);
+        return exitCode;
+    };
+
+    TrainingMode mode = config.Algorithm == "ppo" ? TrainingMode::PPO
+        : (config.Algorithm == "random" ? TrainingMode::AgainstRandom : TrainingMode::Evolution);
+    if (config.Seed != 0)
+    {
+        Random::SetMasterSeed(config.Seed);
+    }
+    m_populationSize = config.Population;
+    m_matchesPerIteration = config.Matches;
+    m_mutationRate = config.MutationRate;
+    m_learningRate = config.LearningRate;
+    m_epsilon = config.Epsilon;
+    m_MCTSEpisodes = config.MctsEpisodes;
+    m_threads = config.Threads;
+    m_searchSettings.Threads = static_cast<unsigned int>(config.Threads);
+
+    std::error_code error;
+    if (!config.CheckpointDir.empty())
+    {
+        std::filesystem::create_directories(config.CheckpointDir, error);
+        m_checkpointPath = (std::filesystem::path(config.CheckpointDir) / (m_baseGame->GetName() + ".ckpt")).string();
+        m_checkpointInterval = config.CheckpointInterval;
+    }
+    std::filesystem::create_directories(config.Output, error);
+
+    std::string bytes;
+    if (config.Resume && !m_checkpointPath.empty() && Checkpoint::Load(m_checkpointPath, bytes))
+    {
+        if (!RestoreCheckpoint(bytes))
+        {
+            return finish(1, "Checkpoint " + m_checkpointPath + " can't be restored.");
+        }
+        // A restored run keeps the settings it was saved with; only the threads follow the config.
+        m_threads = config.Threads;
+        m_searchSettings.Threads = static_cast<unsigned int>(config.Threads);
+        progress << "{\"event\":\"resume\",\"path\":" << JsonString(m_checkpointPath) << ",\"generation\":" << m_run.Generation
+            << ",\"generations\":" << m_run.Generations << ",\"seed\":" << Random::GetMasterSeed() << "}" << std::endl;
+    }
+    else
+    {
+        m_population.clear();
+        for (int i = 0; i < m_populationSize; ++i)
+        {
+            m_population.emplace_back(Player{ std::make_unique<NeuralNetwork>(m_baseGame->StateSize(), config.Layers), 0 });
+        }
+        m_championId = -1;
+        m_championImprovements = 0;
+        StartRun(mode, config.Generations);
+        progress << "{\"event\":\"start\",\"game\":" << JsonString(m_baseGame->GetName()) << ",\"algorithm\":" << JsonString(config.Algorithm)
+            << ",\"generations\":" << config.Generations << ",\"population\":" << m_populationSize << ",\"threads\":" << config.Threads
+            << ",\"seed\":" << Random::GetMasterSeed() << "}" << std::endl;
+    }
+    ContinueRun();
+
+    NeuralNetwork* champion = GetChampion();
+    if (!champion)
+    {
+        champion = m_population[0].NN.get();
+    }
+    if (config.FuzzGames > 0)
+    {
+        float minEval, maxEval;
+        FuzzEvaluationExtremes(*m_baseGame, champion, config.FuzzGames, minEval, maxEval, false);
+        champion->SetKnownEvaluationBounds(minEval, maxEval);
+    }
+    std::string prefix = (std::filesystem::path(config.Output) / m_baseGame->GetName()).string();
+    try
+    {
+        champion->Save(prefix);
+    }
+    catch (...)
+    {
+        return finish(1, "Failed to save the champion to " + config.Output + ".");
+    }
+    if (!m_checkpointPath.empty() && !m_checkpoint.Wait())
+    {
+        return finish(1, "Failed to write checkpoint " + m_checkpointPath + ".");
+    }
+
+    progress << "{\"event\":\"done\",\"generation\":" << m_run.Generation << ",\"champion\":" << champion->Id
+        << ",\"network\":" << JsonString(prefix + std::to_string(champion->Id) + ".nn")
+        << ",\"seconds\":" << std::chrono::duration<double>(std::chrono::steady_clock::now() - m_progressStart).count() << "}" << std::endl;
+    return finish(0, "");
+}
+
+void Trainer::ContinueIterations()
+{
+    std::mt19937& gen = m_run.Generator;
+
+    while (m_run.Generation < m_run.Generations)
+    {
+        int genIndex = m_run.Generation;
         for (auto& player : m_population) 
         {
             player.Wins = 0;
             player.Losses = 0;
         }
+        // The schedule is drawn up front in the order the matches used to be played, so the generator sees the same
+        // draws whatever the thread count. Matches are greedy and deterministic, and every thread adds its results to
+        // its own tallies, which are summed in thread order afterwards.
+        struct ScheduledMatch
+        {
+            int Player;
+            int Opponent;
+            bool PlayerIsSecond;
+        };
+        std::vector<ScheduledMatch> schedule;
+        std::uniform_int_distribution<> dist(0, m_populationSize - 1);
         for (int i = 0; i < m_populationSize; ++i) 
         {
             for (int m = 0; m < m_matchesPerIteration; ++m)
             {
-                std::uniform_int_distribution<> dist(0, m_populationSize - 1);
                 int opponentIdx;
                 do 
                 {
                     opponentIdx = dist(gen);
                 } while (opponentIdx == i);
 
-                NeuralNetwork* netA = m_population[i].NN.get();
-                NeuralNetwork* netB = m_population[opponentIdx].NN.get();
-
                 bool iIsSecond = dist(gen) % 2 == 0;
-                IGame::Winner winner = iIsSecond
-                    ? PlayMatch(netB, netA)
-                    : PlayMatch(netA, netB);
+                schedule.push_back({ i, opponentIdx, iIsSecond });
+            }
+        }
+
+        unsigned int cores = m_threads > 0 ? static_cast<unsigned int>(m_threads) : std::thread::hardware_concurrency();
+        unsigned int threadCount = std::max(1u, std::min(cores, static_cast<unsigned int>(schedule.size())));
+        std::vector<std::vector<int>> wins(threadCount, std::vector<int>(m_populationSize, 0));
+        std::vector<std::vector<int>> losses(threadCount, std::vector<int>(m_populationSize, 0));
+        std::atomic<size_t> nextMatch(0);
+        auto work = [&](unsigned int threadIndex)
+        {
+            auto game = m_baseGame->Clone();
+            auto scratch = m_baseGame->Clone();
+            for (size_t task = nextMatch++; task < schedule.size(); task = nextMatch++)
+            {
+                const ScheduledMatch& match = schedule[task];
+                NeuralNetwork* netA = m_population[match.Player].NN.get();
+                NeuralNetwork* netB = m_population[match.Opponent].NN.get();
+
+                IGame::Winner winner = match.PlayerIsSecond
+                    ? PlayMatch(netB, netA, *game, *scratch)
+                    : PlayMatch(netA, netB, *game, *scratch);
 
                 if (winner == IGame::Winner::Draw) 
                 {
-                    
-                }
-                else if ((iIsSecond && winner == IGame::Winner::SecondPlayer) ||
-                    (!iIsSecond && winner == IGame::Winner::FirstPlayer)) 
-                {
-                    m_population[i].Wins++;
-                    m_population[opponentIdx].Losses++;
-                }
-                else 
-                {
-                    m_population[i].Losses++;
-                    m_population[opponentIdx].Wins++;
+                    continue;
                 }
+                bool playerWon = match.PlayerIsSecond ? winner == IGame::Winner::SecondPlayer : winner == IGame::Winner::FirstPlayer;
+                ++wins[threadIndex][playerWon ? match.Player : match.Opponent];
+                ++losses[threadIndex][playerWon ? match.Opponent : match.Player];
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned int t = 1; t < threadCount; ++t)
+        {
+            threads.emplace_back(work, t);
+        }
+        work(0);
+        for (auto& t : threads) t.join();
+
+        for (unsigned int t = 0; t < threadCount; ++t)
+        {
+            for (int i = 0; i < m_populationSize; ++i)
+            {
+                m_population[i].Wins += wins[t][i];
+                m_population[i].Losses += losses[t][i];
             }
         }
 
@@ -560,11 +1490,12 @@ void Trainer::TrainIterations(int generations)
         }
 
         m_population = std::move(nextGen);
+        FinishGeneration();
     }
 
     std::cout << "\nTraining complete. Champion improved "
         << m_championImprovements << " times over "
-        << generations << " generations.\n";
+        << m_run.Generations << " generations.\n";
     m_championImprovements = 0;
 }
 
@@ -584,13 +1515,19 @@ NeuralNetwork* Trainer::GetChampion()
 
 void Trainer::TrainIterationsAgainstRandom(int generations)
 {
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    StartRun(TrainingMode::AgainstRandom, generations);
+    ContinueIterationsAgainstRandom();
+}
+
+void Trainer::ContinueIterationsAgainstRandom()
+{
+    std::mt19937& gen = m_run.Generator;
 
     const int threadBatchSize = 10;
 
-    for (int genIndex = 0; genIndex < generations; ++genIndex)
+    while (m_run.Generation < m_run.Generations)
     {
+        int genIndex = m_run.Generation;
         for (auto& player : m_population)
         {
             player.Wins = 0;
@@ -601,6 +1538,7 @@ void Trainer::TrainIterationsAgainstRandom(int generations)
         {
             std::vector<std::thread> threads;
             size_t batchEnd = std::min(batchStart + threadBatchSize, m_population.size());
+            uint64_t batchSeed = Random::NextTaskSeed(RandomDomain::Matches);
 
             for (size_t i = batchStart; i < batchEnd; ++i)
             {
@@ -608,14 +1546,16 @@ void Trainer::TrainIterationsAgainstRandom(int generations)
                 {
                     Player& player = m_population[i];
 
-                    std::mt19937 localGen(rd());
+                    std::mt19937 localGen = Random::MakeGenerator(batchSeed, i);
 
                     int localWins = 0;
                     int localLosses = 0;
 
+                    auto game = m_baseGame->Clone();
+                    auto scratch = m_baseGame->Clone();
                     for (int m = 0; m < m_matchesPerIteration; ++m)
                     {
-                        auto game = m_baseGame->Clone();
+                        game->CopyFrom(*m_baseGame);
                         std::uniform_int_distribution<> coin(0, 1);
                         bool aiPlaysFirst = coin(localGen) == 0;
 
@@ -626,12 +1566,13 @@ void Trainer::TrainIterationsAgainstRandom(int generations)
 
                             if ((playerTurn == 1 && aiPlaysFirst) || (playerTurn == 2 && !aiPlaysFirst))
                             {
-                                move = ChooseBestMove(*game, player.NN.get());
+                                move = ChooseBestMove(*game, player.NN.get(), *scratch);
                             }
                             else
                             {
-                                auto valid = game->GetValidMoves();
-                                std::uniform_int_distribution<> randMove(0, static_cast<int>(valid.size()) - 1);
+                                MoveList valid;
+                                game->GenerateMoves(valid);
+                                std::uniform_int_distribution<> randMove(0, valid.Count - 1);
                                 move = valid[randMove(localGen)];
                             }
 
@@ -708,73 +1649,28 @@ void Trainer::TrainIterationsAgainstRandom(int generations)
         }
 
         m_population = std::move(nextGen);
+        FinishGeneration();
     }
 
     std::cout << "\n[Random Trainer] Champion improved "
         << m_championImprovements << " times over "
-        << generations << " generations.\n";
+        << m_run.Generations << " generations.\n";
     m_championImprovements = 0;
 }
 
 
-IGame::Winner Trainer::PlayMatch(NeuralNetwork* nn1, NeuralNetwork* nn2) 
+IGame::Winner Trainer::PlayMatch(NeuralNetwork* nn1, NeuralNetwork* nn2, IGame& game, IGame& scratch) 
 {
-    auto game = m_baseGame->Clone();
-
-    while (game->GetWinner() == IGame::Winner::OnGoing) 
-    {
-        NeuralNetwork* currentNN = game->GetCurrentPlayer() == 1 ? nn1 : nn2;
-        int move = ChooseBestMove(*game, currentNN);
-        game->MakeMove(move);
-    }
-
-    return game->GetWinner();
+    game.CopyFrom(*m_baseGame);
+    NetworkScorer first(nn1);
+    NetworkScorer second(nn2);
+    return Engine().PlayMatch(game, first, second, scratch);
 }
 
-int Trainer::ChooseBestMove(const IGame& game, const NeuralNetwork* network) 
+int Trainer::ChooseBestMove(const IGame& game, const NeuralNetwork* network, IGame& scratch) 
 {
-    std::vector<int> validMoves = game.GetValidMoves();
-    int currentPlayer = game.GetCurrentPlayer();
-
-    float bestScore = currentPlayer == 1 ? std::numeric_limits<float>::max() : -std::numeric_limits<float>::max();;
-    int bestMove = -1;
-
-
-    for (int move : validMoves) 
-    {
-        auto simGame = CloneGameWithMove(game, move);
-        float score = network->Evaluate(simGame->GetBoardState());
-
-        //std::cout << "Score: " << score << "\n";
-        //std::cout << "Current player: " << simGame->GetCurrentPlayer() << "\n";
-        //simGame->PrintBoard();
-
-        if (currentPlayer != 1) 
-        {
-            if (score > bestScore) 
-            {
-                bestScore = score;
-                bestMove = move;
-            }
-        }
-        else 
-        {
-            if (score < bestScore) 
-            {
-                bestScore = score;
-                bestMove = move;
-            }
-        }
-    }
-
-    if (bestMove == -1 && !validMoves.empty()) 
-    {
-        game.PrintBoard();
-        std::cerr << "[WARNING] No best move found. Choosing fallback.\n";
-        bestMove = validMoves[0];
-    }
-
-    return bestMove;
+    NetworkScorer scorer(network);
+    return Engine().ChooseBestMove(game, scorer, scratch);
 }
 
 void Trainer::ApplyPPORewards(NeuralNetwork* nn, std::vector<Step>& history)
@@ -791,40 +1687,104 @@ void Trainer::ApplyPPORewards(NeuralNetwork* nn, std::vector<Step>& history)
     }
 }
 
+void Trainer::RecordSymmetricSteps(const IGame& game, float valueEstimate, std::vector<std::vector<Step>>& symmetricSteps) const
+{
+    symmetricSteps.emplace_back();
+    if (!m_augmentSymmetries)
+    {
+        return;
+    }
+
+    for (int transform = 1; transform < game.SymmetryCount(); ++transform)
+    {
+        bool swapsPlayers = game.SwapsPlayers(transform);
+        std::vector<float> state(game.StateSize());
+        game.EncodeSymmetricState(state.data(), transform);
+        symmetricSteps.back().push_back({
+            std::move(state),
+            swapsPlayers ? -valueEstimate : valueEstimate,
+            0.0f,
+            swapsPlayers ? 3 - game.GetCurrentPlayer() : game.GetCurrentPlayer()
+            });
+    }
+}
+
 IGame::Winner Trainer::PlayMatchPPO(NeuralNetwork* nn)
 {
     auto game = m_baseGame->Clone();
     std::vector<Step> history;
+    std::vector<std::vector<Step>> symmetricSteps;
+    // Steps the oracle reaches are trained on their exact result instead of the blended one.
+    std::vector<std::pair<size_t, float>> exactRewards;
+    auto recordExactReward = [&]()
     {
-        float valueEstimate = nn->GetClampedEvaluation(game->GetBoardState());
-        MonteCarlo::EvaluationAndMove result = MonteCarlo::MonteCarloTreeSearch(*game, m_MCTSEpisodes, nn);
+        float exact;
+        if (m_oracle && m_useOracle && m_oracle->Probe(*game, exact))
+        {
+            exactRewards.push_back({ history.size() - 1, exact });
+        }
+    };
+    // Opening plies with the root visits of their searches, appended to the self-play log when the game ends.
+    std::vector<OpeningBook::LoggedPly> loggedPlies;
+    auto logPly = [&](const MonteCarlo::EvaluationAndMove& result, int move)
+    {
+        if (m_selfPlayLogPath.empty() || static_cast<int>(loggedPlies.size()) >= m_selfPlayLogPlies)
+        {
+            return;
+        }
+        OpeningBook::LoggedPly ply = { game->GetHash(), static_cast<int>(loggedPlies.size()), game->GetCurrentPlayer(), move, {} };
+        for (const MonteCarlo::RootMove& root : result.RootMoves)
+        {
+            ply.Visits.push_back({ root.Move, root.Visits });
+        }
+        loggedPlies.push_back(std::move(ply));
+    };
+    std::mt19937 gen = Random::MakeGenerator(Random::NextTaskSeed(RandomDomain::Matches));
+    {
+        std::vector<float> state = game->GetBoardState();
+        float valueEstimate = m_evaluationCache.GetClampedEvaluation(*nn, *game);
+        MonteCarlo::EvaluationAndMove result = SearchMove(*game, m_MCTSEpisodes, nn);
         history.push_back({
-            game->GetBoardState(),
+            std::move(state),
             valueEstimate,
             result.stateEvaluation,
             game->GetCurrentPlayer()
             });
-
-        const auto& validMoves = game->GetValidMoves();
-        game->MakeMove(validMoves[std::rand() % validMoves.size()]);
+        RecordSymmetricSteps(*game, valueEstimate, symmetricSteps);
+        recordExactReward();
+
+        MoveList validMoves;
+        game->GenerateMoves(validMoves);
+        std::uniform_int_distribution<> randMove(0, validMoves.Count - 1);
+        int move = validMoves[randMove(gen)];
+        logPly(result, move);
+        game->MakeMove(move);
     }
 
     while (game->GetWinner() == IGame::Winner::OnGoing)
     {
-        float valueEstimate = nn->GetClampedEvaluation(game->GetBoardState());
+        std::vector<float> state = game->GetBoardState();
+        float valueEstimate = m_evaluationCache.GetClampedEvaluation(*nn, *game);
         
 
-        MonteCarlo::EvaluationAndMove result = MonteCarlo::MonteCarloTreeSearch(*game, m_MCTSEpisodes, nn);
+        MonteCarlo::EvaluationAndMove result = SearchMove(*game, m_MCTSEpisodes, nn);
         history.push_back({
-            game->GetBoardState(),
+            std::move(state),
             valueEstimate,
             result.stateEvaluation,
             game->GetCurrentPlayer()
             });
+        RecordSymmetricSteps(*game, valueEstimate, symmetricSteps);
+        recordExactReward();
+        logPly(result, result.Move);
         game->MakeMove(result.Move);
     }
 
     IGame::Winner winner = game->GetWinner();
+    if (!loggedPlies.empty() && !OpeningBook::AppendGame(m_selfPlayLogPath, m_baseGame->GetName(), loggedPlies, winner))
+    {
+        std::cout << "Could not write self-play log " << m_selfPlayLogPath << "\n";
+    }
     float finalOutcome;
     if (winner == IGame::Winner::FirstPlayer)
     {
@@ -852,6 +1812,21 @@ IGame::Winner Trainer::PlayMatchPPO(NeuralNetwork* nn)
         currentBlend *= decayRate;
     }
 
+    for (const auto& exact : exactRewards)
+    {
+        history[exact.first].Reward = exact.second;
+    }
+
+    // Symmetric copies share the blended reward of their step, negated when the transform swapped the players.
+    for (size_t i = 0; i < symmetricSteps.size(); ++i)
+    {
+        for (Step& step : symmetricSteps[i])
+        {
+            step.Reward = step.Player == history[i].Player ? history[i].Reward : -history[i].Reward;
+            history.push_back(std::move(step));
+        }
+    }
+
     ApplyPPORewards(nn, history);
 
     float minEval, maxEval;
@@ -863,7 +1838,7 @@ IGame::Winner Trainer::PlayMatchPPO(NeuralNetwork* nn)
 
 
 
-void Trainer::TestChampionAgainstRandom(int games) 
+void Trainer::TestChampion(int games, const GameOracle* opponent) 
 {
     NeuralNetwork* ai = GetChampion();
     if (!ai) 
@@ -872,15 +1847,15 @@ void Trainer::TestChampionAgainstRandom(int games)
         return;
     }
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937 gen = Random::MakeGenerator(Random::NextTaskSeed(RandomDomain::Matches));
 
     int firstWins = 0, firstDraws = 0, firstLosses = 0;
     int secondWins = 0, secondDraws = 0, secondLosses = 0;
 
+    auto game = m_baseGame->Clone();
     for (int i = 0; i < games; ++i) 
     {
-        auto game = m_baseGame->Clone();
+        game->CopyFrom(*m_baseGame);
         bool aiPlaysFirst = (i < games / 2);
 
         while (game->GetWinner() == IGame::Winner::OnGoing) 
@@ -890,13 +1865,18 @@ void Trainer::TestChampionAgainstRandom(int games)
 
             if ((player == 1 && aiPlaysFirst) || (player == 2 && !aiPlaysFirst)) 
             {
-                move = MonteCarlo::MonteCarloTreeSearch(*game, 100, ai).Move;
+                move = SearchMove(*game, 100, ai).Move;
             }
             else
             {
-                auto valid = game->GetValidMoves();
-                std::uniform_int_distribution<> randMove(0, valid.size() - 1);
-                move = valid[randMove(gen)];
+                move = opponent ? opponent->BestMove(*game) : -1;
+                if (move < 0)
+                {
+                    MoveList valid;
+                    game->GenerateMoves(valid);
+                    std::uniform_int_distribution<> randMove(0, valid.Count - 1);
+                    move = valid[randMove(gen)];
+                }
             }
 
             game->MakeMove(move);
@@ -935,7 +1915,7 @@ void Trainer::TestChampionAgainstRandom(int games)
         }
     }
 
-    std::cout << "\n=== Champion Test Results vs Random Agent ===\n";
+    std::cout << "\n=== Champion Test Results vs " << (opponent ? "Solver" : "Random Agent") << " ===\n";
 
     auto percent = [](int value, int total) -> double 
     {
@@ -958,11 +1938,15 @@ void Trainer::TestChampionAgainstRandom(int games)
 
 void Trainer::TrainIterationsPPO(int generations)
 {
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    StartRun(TrainingMode::PPO, generations);
+    ContinueIterationsPPO();
+}
 
-    for (int genIndex = 0; genIndex < generations; ++genIndex)
+void Trainer::ContinueIterationsPPO()
+{
+    while (m_run.Generation < m_run.Generations)
     {
+        int genIndex = m_run.Generation;
         NeuralNetwork* championNN = GetChampion();
         if (!championNN)
         {
@@ -975,8 +1959,10 @@ void Trainer::TrainIterationsPPO(int generations)
         m_championId = m_population[0].NN->Id;
 
         std::cout << "Finished PPO generation " << genIndex << "\n";
+        FinishGeneration();
 
-        if (_kbhit())
+#ifdef _WIN32
+        if (!m_progress && _kbhit())
         {
             char ch = _getch();
             if (ch == 'q' || ch == 'Q')
@@ -985,6 +1971,7 @@ void Trainer::TrainIterationsPPO(int generations)
                 break;
             }
         }
+#endif
     }
 }
 
@@ -1005,9 +1992,28 @@ void Trainer::EvaluateAndPromoteChampion()
 }
 
 
-std::unique_ptr<IGame> Trainer::CloneGameWithMove(const IGame& game, int move) 
+MonteCarlo::EvaluationAndMove Trainer::SearchMove(IGame& game, int iterations, NeuralNetwork* nn)
 {
-    std::unique_ptr<IGame> copy = game.Clone();
-    copy->MakeMove(move);
-    return copy;
+    NeuralLeafEvaluator neural(nn, &m_evaluationCache);
+    RandomPlayoutEvaluator playouts(1, 400, m_simulationEngine.get());
+    MixedLeafEvaluator mixed(neural, playouts, m_playoutLambda);
+    if (m_oracle && m_useOracle)
+    {
+        // A position the oracle solves needs no search: its move keeps the exact result.
+        float exactValue;
+        if (m_oracle->Probe(game, exactValue))
+        {
+            int move = m_oracle->BestMove(game);
+            if (move >= 0)
+            {
+                MonteCarlo::EvaluationAndMove result = {};
+                result.Move = move;
+                result.stateEvaluation = exactValue;
+                return result;
+            }
+        }
+        OracleLeafEvaluator exact(*m_oracle, mixed);
+        return MonteCarlo::MonteCarloTreeSearch(game, iterations, exact, m_searchSettings);
+    }
+    return MonteCarlo::MonteCarloTreeSearch(game, iterations, mixed, m_searchSettings);
 }
@@ -0,0 +1,230 @@
+#include "TrainingConfig.h"
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	std::string Trim(const std::string& text)
+	{
+		size_t begin = text.find_first_not_of(" \t\r\n");
+		if (begin == std::string::npos)
+		{
+			return "";
+		}
+		size_t end = text.find_last_not_of(" \t\r\n");
+		return text.substr(begin, end - begin + 1);
+	}
+
+	bool ParseInt(const std::string& text, long long minimum, int& value)
+	{
+		char* end = nullptr;
+		long long parsed = std::strtoll(text.c_str(), &end, 10);
+		if (text.empty() || *end != '\0' || parsed < minimum || parsed > INT32_MAX)
+		{
+			return false;
+		}
+		value = static_cast<int>(parsed);
+		return true;
+	}
+
+	bool ParseFloat(const std::string& text, float& value)
+	{
+		char* end = nullptr;
+		float parsed = std::strtof(text.c_str(), &end);
+		if (text.empty() || *end != '\0' || !(parsed > 0.0f))
+		{
+			return false;
+		}
+		value = parsed;
+		return true;
+	}
+}
+
+bool TrainingConfig::Parse(int argc, char** argv, int first, TrainingConfig& config, std::string& error)
+{
+	for (int i = first; i + 1 < argc; ++i)
+	{
+		if (std::string(argv[i]) == "--config" && !config.LoadFile(argv[i + 1], error))
+		{
+			return false;
+		}
+	}
+
+	for (int i = first; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		if (argument.size() < 3 || argument.compare(0, 2, "--") != 0 || i + 1 >= argc)
+		{
+			error = "Expected --key value, got " + argument;
+			return false;
+		}
+		std::string key = argument.substr(2);
+		std::string value = argv[++i];
+		if (key != "config" && !config.Set(key, value, error))
+		{
+			return false;
+		}
+	}
+
+	if (config.Game.empty())
+	{
+		error = "No game given.";
+		return false;
+	}
+	return true;
+}
+
+bool TrainingConfig::Set(const std::string& key, const std::string& value, std::string& error)
+{
+	bool valid = true;
+	if (key == "game")
+	{
+		Game = value;
+	}
+	else if (key == "modules")
+	{
+		Modules = value;
+	}
+	else if (key == "layers")
+	{
+		Layers.clear();
+		std::istringstream sizes(value);
+		std::string size;
+		while (valid && std::getline(sizes, size, ','))
+		{
+			int neurons = 0;
+			valid = ParseInt(Trim(size), 1, neurons);
+			Layers.push_back(neurons);
+		}
+	}
+	else if (key == "algorithm")
+	{
+		Algorithm = value;
+		valid = value == "evolution" || value == "random" || value == "ppo";
+	}
+	else if (key == "generations")
+	{
+		valid = ParseInt(value, 1, Generations);
+	}
+	else if (key == "threads")
+	{
+		valid = ParseInt(value, 0, Threads);
+	}
+	else if (key == "seed")
+	{
+		char* end = nullptr;
+		Seed = std::strtoull(value.c_str(), &end, 10);
+		valid = !value.empty() && *end == '\0';
+	}
+	else if (key == "population")
+	{
+		valid = ParseInt(value, 2, Population) && Population % 2 == 0;
+	}
+	else if (key == "matches")
+	{
+		valid = ParseInt(value, 0, Matches);
+	}
+	else if (key == "mutation-rate")
+	{
+		valid = ParseInt(value, 0, MutationRate);
+	}
+	else if (key == "learning-rate")
+	{
+		valid = ParseFloat(value, LearningRate);
+	}
+	else if (key == "epsilon")
+	{
+		valid = ParseFloat(value, Epsilon);
+	}
+	else if (key == "mcts-episodes")
+	{
+		valid = ParseInt(value, 1, MctsEpisodes);
+	}
+	else if (key == "checkpoint-dir")
+	{
+		CheckpointDir = value;
+	}
+	else if (key == "checkpoint-interval")
+	{
+		valid = ParseInt(value, 1, CheckpointInterval);
+	}
+	else if (key == "resume")
+	{
+		Resume = value == "true" || value == "1";
+		valid = Resume || value == "false" || value == "0";
+	}
+	else if (key == "output")
+	{
+		Output = value;
+	}
+	else if (key == "fuzz-games")
+	{
+		valid = ParseInt(value, 0, FuzzGames);
+	}
+	else
+	{
+		error = "Unknown setting " + key;
+		return false;
+	}
+
+	if (!valid)
+	{
+		error = "Invalid value for " + key + ": " + value;
+	}
+	return valid;
+}
+
+bool TrainingConfig::LoadFile(const std::string& path, std::string& error)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		error = "Can't read config file " + path;
+		return false;
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		line = Trim(line.substr(0, line.find('#')));
+		if (line.empty())
+		{
+			continue;
+		}
+		size_t equals = line.find('=');
+		if (equals == std::string::npos)
+		{
+			error = path + ":" + std::to_string(lineNumber) + ": expected key = value";
+			return false;
+		}
+		if (!Set(Trim(line.substr(0, equals)), Trim(line.substr(equals + 1)), error))
+		{
+			error = path + ":" + std::to_string(lineNumber) + ": " + error;
+			return false;
+		}
+	}
+	return true;
+}
+
+const char* TrainingConfig::Usage()
+{
+	return "Trainer --train [--config file] [--key value]...\n"
+		"  game                 name of the game to train (required)\n"
+		"  modules              directory of the game modules (default: the executable's)\n"
+		"  layers               hidden layer sizes, e.g. 42,42,21,8\n"
+		"  algorithm            evolution, random or ppo (default: evolution)\n"
+		"  generations          generations to train (default: 100)\n"
+		"  threads              threads for matches and searches, 0 for all cores\n"
+		"  seed                 master random seed, 0 for a random one\n"
+		"  population, matches, mutation-rate, learning-rate, epsilon, mcts-episodes\n"
+		"                       training parameters as in the parameters menu\n"
+		"  checkpoint-dir       directory for checkpoints (default: none)\n"
+		"  checkpoint-interval  generations between checkpoints (default: 10)\n"
+		"  resume               true to continue the run saved in the checkpoint directory\n"
+		"  output               directory the champion network is saved to (default: .)\n"
+		"  fuzz-games           random games that set the champion's evaluation bounds before saving\n"
+		"Config files hold one key = value per line; # starts a comment. Progress is written to stdout as JSON lines.\n";
+}
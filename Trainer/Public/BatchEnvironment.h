@@ -0,0 +1,24 @@
+#pragma once
+#include "IGame.h"
+#include <random>
+
+/// <summary>Many games of one type stepped together by a game module, e.g. for batched self-play and evaluation.
+/// Games start at the initial position, and a finished game starts over right after its result is reported.</summary>
+class BatchEnvironment
+{
+public:
+	virtual int Size() const = 0;
+	/// <summary>Floats per game written by EncodeStates, the same encoding as the game's IGame::EncodeState.</summary>
+	virtual int StateSize() const = 0;
+	/// <summary>Starts every game over.</summary>
+	virtual void Reset() = 0;
+	/// <summary>Plays one move per game for the player to move, with the move ids of IGame. Winners receives one IGame::Winner
+	/// per game. An illegal move leaves its game unchanged and reports OnGoing. Returns the number of illegal moves.</summary>
+	virtual int Step(const int* moves, int* winners) = 0;
+	/// <summary>Writes Size() * StateSize() floats, one state per game.</summary>
+	virtual void EncodeStates(float* states) const = 0;
+	/// <summary>Picks a uniformly random legal move for every game.</summary>
+	virtual void SampleRandomMoves(std::mt19937& rng, int* moves) const = 0;
+	virtual int GetCurrentPlayer(int game) const = 0;
+	inline virtual ~BatchEnvironment() {}
+};
@@ -0,0 +1,111 @@
+#pragma once
+#include "IGame.h"
+#include "SimulationEngine.h"
+#include "GameOracle.h"
+#include "BatchEnvironment.h"
+#include <random>
+#include <string>
+#include <vector>
+
+/// <summary>Timing helpers for the game engines and the search built on top of them.</summary>
+class Benchmark
+{
+public:
+	struct PerftResult
+	{
+		long long LeafNodes = 0;
+		long long MovesMade = 0;
+		double Seconds = 0.0;
+	};
+
+	struct HashCheckResult
+	{
+		long long Positions = 0;
+		/// <summary>Moves after whose undo the hash differed from the one before the move.</summary>
+		long long Mismatches = 0;
+		/// <summary>Equal hashes for positions whose board state differs.</summary>
+		long long Collisions = 0;
+		/// <summary>Symmetric hashes, encodings or canonical forms that disagree with the position reached by playing the
+		/// transformed moves, or symmetric hashes shared with a different board.</summary>
+		long long SymmetryMismatches = 0;
+	};
+
+	struct UndoCheckResult
+	{
+		long long Moves = 0;
+		long long Undos = 0;
+		/// <summary>Undos after which the position differed from the snapshot taken before the move.</summary>
+		long long Mismatches = 0;
+	};
+
+	/// <summary>Plays every move sequence of the given length with MakeMove/UnMakeMove. Finished games end a sequence early.
+	/// Runs inside the engine when one is given, otherwise through IGame.</summary>
+	static PerftResult Perft(IGame& game, int depth, const SimulationEngine* engine = nullptr);
+	/// <summary>Runs perft for depths 1 to maxDepth from the given position and prints nodes and moves per second,
+	/// for the engine as well when one is given.</summary>
+	static void RunPerft(const IGame& game, int maxDepth, const SimulationEngine* engine = nullptr);
+	/// <summary>Times the same seeded playout search once through IGame and once with the tree and the playouts in the engine.</summary>
+	static void RunSearchComparison(const IGame& game, const SimulationEngine& engine, int iterations);
+	/// <summary>Plays random games and checks that undoing moves restores the hash and that different boards do not share one.
+	/// Symmetries that keep the players are checked by playing every move transformed on a copy of the start position, which has
+	/// to be symmetric itself; symmetries that exchange them join the collision check. Debug builds also compare every hash
+	/// against one computed from scratch.</summary>
+	static HashCheckResult CheckHashes(IGame& game, int games, std::mt19937& rng);
+	static void RunHashCheck(const IGame& game, int games);
+	/// <summary>Plays random games that take moves back at random points and compares every undo with a copy of the position
+	/// made before the move: hash, side to move, winner, encoded board and legal moves.</summary>
+	static UndoCheckResult CheckUndo(IGame& game, int games, std::mt19937& rng);
+	static void RunUndoCheck(const IGame& game, int games);
+	struct BatchCheckResult
+	{
+		long long Moves = 0;
+		double BatchSeconds = 0.0;
+		/// <summary>Time the same moves took through IGame, one game object per batch game.</summary>
+		double GameSeconds = 0.0;
+		/// <summary>Steps after which a batch game's winner or encoded state differed from its game object's.</summary>
+		long long Mismatches = 0;
+	};
+
+	/// <summary>Steps every batch game with random moves for the given number of steps and plays the same moves on game
+	/// objects cloned from the start position, comparing winners and encoded states after every step.</summary>
+	static BatchCheckResult CheckBatchEnvironment(const IGame& game, BatchEnvironment& batch, int steps, std::mt19937& rng);
+	/// <summary>Probes every position of random games and prints how many the oracle reached and the time per probe and best move.</summary>
+	static void RunOracleBenchmark(const IGame& game, const GameOracle& oracle, int games);
+
+	/// <summary>One measurement of the game benchmark suite, written as a JSON line.</summary>
+	struct SuiteResult
+	{
+		std::string Game;
+		std::string Test;
+		/// <summary>Leaf nodes for perft, otherwise the number of games or states that were timed.</summary>
+		long long Count = 0;
+		/// <summary>Whether Count is fixed by the rules of the game, so any other build has to reproduce it.</summary>
+		bool ExactCount = false;
+		double Seconds = 0.0;
+		/// <summary>Moves, games or encodes per second.</summary>
+		double Rate = 0.0;
+	};
+
+	struct SuiteSettings
+	{
+		int MaxPerftDepth = 8;
+		/// <summary>Perft stops before a depth that is expected to take longer than this.</summary>
+		double PerftSeconds = 5.0;
+		/// <summary>Time spent on each throughput measurement.</summary>
+		double ThroughputSeconds = 1.0;
+	};
+
+	/// <summary>Perft from the start and from fixed mid-game positions, random games per second and encodes per second.
+	/// Perft and playouts run inside the engine when one is given.</summary>
+	static std::vector<SuiteResult> RunGameSuite(const IGame& game, const SimulationEngine* engine, const SuiteSettings& settings);
+	static bool WriteSuiteResults(const std::string& path, const std::vector<SuiteResult>& results);
+	/// <summary>Reads results written by WriteSuiteResults. Returns an empty list when the file can't be opened.</summary>
+	static std::vector<SuiteResult> ReadSuiteResults(const std::string& path);
+	/// <summary>Prints every rate next to the baseline's. Returns the number of exact counts that differ from it.</summary>
+	static int CompareToBaseline(const std::vector<SuiteResult>& results, const std::vector<SuiteResult>& baseline);
+
+private:
+	static void PerftRecursive(IGame& game, int depth, PerftResult& result);
+	/// <summary>Positions reached by fixed pseudo-random move sequences, the same for every build and platform.</summary>
+	static std::vector<std::unique_ptr<IGame>> MidGamePositions(const IGame& game);
+};
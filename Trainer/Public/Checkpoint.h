@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <thread>
+
+/// <summary>Binary snapshots of a training run. Values are stored in the machine's byte order, so checkpoints only move
+/// between machines of the same kind. Files are written on a background thread, so training goes on while they are saved.</summary>
+class Checkpoint
+{
+public:
+	~Checkpoint();
+
+	template <typename T>
+	static void Write(std::ostream& out, const T& value)
+	{
+		out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	static void Read(std::istream& in, T& value)
+	{
+		in.read(reinterpret_cast<char*>(&value), sizeof(T));
+	}
+
+	static void WriteString(std::ostream& out, const std::string& value);
+	static void ReadString(std::istream& in, std::string& value);
+
+	/// <summary>Writes the bytes to the path in the background. The file is written next to the path and renamed over it once
+	/// complete, so a crash while saving leaves the previous checkpoint intact. Waits for the previous save first.</summary>
+	void SaveAsync(const std::string& path, std::string bytes);
+	/// <summary>Waits for the save in progress. Returns false when the last save failed.</summary>
+	bool Wait();
+	static bool Load(const std::string& path, std::string& bytes);
+
+private:
+	std::thread m_writer;
+	bool m_lastSaved = true;
+};
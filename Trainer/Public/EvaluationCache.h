@@ -0,0 +1,54 @@
+#pragma once
+#include "IGame.h"
+#include "NeuralNetwork.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/// <summary>Fixed-size table from position hash, network Id and network version to the raw network evaluation.
+/// Buckets hold a few entries in one cache line. Reads and writes are lock-free, so all search threads can share one cache;
+/// an entry torn by a concurrent write fails its check and reads as a miss.
+/// Changing the weights gives the network a new version, which leaves its old entries unreachable.</summary>
+class EvaluationCache
+{
+public:
+	static constexpr int Ways = 4;
+
+	EvaluationCache(size_t bytes = 32 * 1024 * 1024);
+
+	/// <summary>Reallocates the table with at most the given size and drops all entries. Not safe while searches use the cache.</summary>
+	void Resize(size_t bytes);
+	void Clear();
+
+	/// <summary>Raw evaluation of the position, from the cache or from the network.</summary>
+	float Evaluate(const NeuralNetwork& network, const IGame& state);
+	float GetClampedEvaluation(const NeuralNetwork& network, const IGame& state);
+
+	static uint64_t Key(uint64_t positionHash, const NeuralNetwork& network);
+	bool Probe(uint64_t key, float& rawEvaluation) const;
+	void Store(uint64_t key, float rawEvaluation);
+
+	size_t MemoryBytes() const;
+	long long Hits() const;
+	long long Misses() const;
+	double HitRate() const;
+	void ResetStats();
+
+private:
+	struct Entry
+	{
+		/// <summary>Key xor Data, so a pair written by two threads at once does not match any key.</summary>
+		std::atomic<uint64_t> Check;
+		std::atomic<uint64_t> Data;
+	};
+
+	struct alignas(64) Bucket
+	{
+		Entry Entries[Ways];
+	};
+
+	std::unique_ptr<Bucket[]> m_buckets;
+	size_t m_bucketCount = 0;
+	mutable std::atomic<long long> m_hits;
+	mutable std::atomic<long long> m_misses;
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include "IGame.h"
+#include "SimulationEngine.h"
+#include "GameOracle.h"
+#include "BatchEnvironment.h"
+#include <string>
+#include <vector>
+
+typedef IGame* (*CreateGameFunc)();
+typedef const char* (*GetGameNameFunc)();
+typedef SimulationEngine* (*CreateSimulationEngineFunc)();
+typedef GameOracle* (*CreateGameOracleFunc)();
+typedef BatchEnvironment* (*CreateBatchEnvironmentFunc)(int games);
+
+/// <summary>Game modules loaded from a directory: the .dll files on Windows and the .so files elsewhere.
+/// Modules stay loaded for the life of the process, so games made by them can outlive the list.</summary>
+class GameModules
+{
+public:
+	struct Entry
+	{
+		/// <summary>HMODULE on Windows, dlopen handle elsewhere.</summary>
+		void* Handle;
+		std::string Name;
+		CreateGameFunc CreateFunc;
+		/// <summary>Optional, null for modules without an engine.</summary>
+		CreateSimulationEngineFunc CreateEngineFunc;
+		/// <summary>Optional, null for modules without a solver or database.</summary>
+		CreateGameOracleFunc CreateOracleFunc;
+		/// <summary>Optional, null for modules that can't step games in batches.</summary>
+		CreateBatchEnvironmentFunc CreateBatchFunc;
+	};
+
+	/// <summary>Loads every game module in the directory, or next to the executable when it is empty. Files that aren't
+	/// game modules are skipped.</summary>
+	void LoadAll(const std::string& directory = "");
+	const std::vector<Entry>& Games() const;
+	/// <summary>The loaded module of the game with this name, null when there is none.</summary>
+	const Entry* Find(const std::string& name) const;
+	static std::string ExecutableDirectory();
+
+private:
+	std::vector<Entry> m_games;
+};
@@ -0,0 +1,22 @@
+#pragma once
+#include "IGame.h"
+#include <string>
+
+/// <summary>Exact results from a game module, e.g. a solver or an endgame database. Answers are the results with perfect play
+/// and do not depend on the network, so they can score search leaves, train values and act as an opponent.</summary>
+class GameOracle
+{
+public:
+	/// <summary>Writes the result with perfect play from the first player's perspective: 1 win, 0 draw, -1 loss.
+	/// Returns false for positions out of the oracle's reach. Safe to call from several threads.</summary>
+	virtual bool Probe(const IGame& state, float& value) const = 0;
+	/// <summary>A move keeping the best result with perfect play, or -1 when the position is out of reach or finished.</summary>
+	virtual int BestMove(const IGame& state) const = 0;
+	/// <summary>How much search Probe may spend on a position its database doesn't cover; the unit depends on the game. 0 allows lookups only.</summary>
+	virtual void SetProbeLimit(int limit) = 0;
+	virtual int GetProbeLimit() const = 0;
+	/// <summary>Precomputes a database of the given size, in a unit that depends on the game, writes it to the file and uses it.</summary>
+	virtual bool BuildDatabase(const std::string& path, int size) = 0;
+	virtual bool LoadDatabase(const std::string& path) = 0;
+	inline virtual ~GameOracle() {}
+};
@@ -1,4 +1,8 @@
 #pragma once
+// Every module keeps its own copy of this header. The shared guard lets a game include headers of the trainer
+// without the two copies clashing, so the copies have to stay identical.
+#ifndef IGAME_INTERFACE_H
+#define IGAME_INTERFACE_H
 
 #define GAME_API __declspec(dllimport)
 
@@ -6,6 +10,18 @@
 #include <string>
 #include <memory>
 #include <unordered_map>
+#include <cstdint>
+
+/// <summary>Fixed-size move buffer for IGame::GenerateMoves, meant to live on the stack so move generation never allocates.</summary>
+struct MoveList {
+    static const int Capacity = 512;
+    int Moves[Capacity];
+    int Count = 0;
+
+    inline int operator[](int index) const { return Moves[index]; }
+    inline const int* begin() const { return Moves; }
+    inline const int* end() const { return Moves + Count; }
+};
 
 class IGame {
 public:
@@ -17,23 +33,80 @@ public:
     };
 
     inline IGame() {}
-    inline IGame(IGame& other) {}
+    IGame(const IGame&) = default;
+    IGame& operator=(const IGame&) = default;
 
     virtual std::unordered_map<int, std::string> GetSpritePaths() const = 0;
     virtual std::vector<std::vector<int>> GetSpriteGrid() const = 0;
     virtual std::string GetName() const = 0;
     virtual void Reset() = 0;
-    virtual std::vector<int> GetValidMoves() const = 0;
+    /// <summary>Overwrites the list with the legal moves and returns how many there are.</summary>
+    virtual int GenerateMoves(MoveList& moves) const = 0;
+    inline virtual std::vector<int> GetValidMoves() const
+    {
+        MoveList moves;
+        GenerateMoves(moves);
+        return std::vector<int>(moves.begin(), moves.end());
+    }
     virtual bool MakeMove(int x, int y) = 0;
     virtual bool MakeMove(int moveId) = 0;
     virtual bool UnMakeMove() = 0;
     virtual Winner GetWinner() const = 0;
     virtual void PrintBoard() const = 0;
     virtual int GetCurrentPlayer() const = 0;
+    /// <summary>Zobrist hash of the position, side to move included. Kept up to date by every move and undo.</summary>
+    virtual uint64_t GetHash() const = 0;
+
+    /// <summary>A symmetric position and the transform that maps this position onto it.</summary>
+    struct CanonicalForm {
+        uint64_t Hash;
+        int Transform;
+    };
+
+    /// <summary>Number of symmetries of the game, the identity included. Transform 0 is always the identity.</summary>
+    virtual int SymmetryCount() const = 0;
+    /// <summary>Hash the position would have after mapping it through the transform, built from the board.</summary>
+    virtual uint64_t GetSymmetricHash(int transform) const = 0;
+    /// <summary>Maps a move of this position to the matching move of the transformed position.</summary>
+    virtual int TransformMove(int move, int transform) const = 0;
+    virtual int InverseTransform(int transform) const = 0;
+    /// <summary>Whether the transform exchanges the players. Values from the first player's view change sign under it.</summary>
+    virtual bool SwapsPlayers(int transform) const = 0;
+    /// <summary>EncodeState of the transformed position.</summary>
+    virtual void EncodeSymmetricState(float* state, int transform) const = 0;
+    /// <summary>The symmetric position with the smallest hash, shared by all positions that are symmetric to each other.
+    /// TransformMove with the returned transform maps moves of this position to the canonical one.</summary>
+    inline CanonicalForm Canonicalize() const
+    {
+        CanonicalForm best = { GetHash(), 0 };
+        for (int transform = 1; transform < SymmetryCount(); ++transform)
+        {
+            uint64_t hash = GetSymmetricHash(transform);
+            if (hash < best.Hash)
+            {
+                best = { hash, transform };
+            }
+        }
+        return best;
+    }
 
-    virtual std::vector<float> GetBoardState() const = 0;
+    /// <summary>Number of floats EncodeState writes.</summary>
+    virtual int StateSize() const = 0;
+    /// <summary>Writes the network input for the position to StateSize() floats at the destination, e.g. a row of a batch.</summary>
+    virtual void EncodeState(float* state) const = 0;
+    inline virtual std::vector<float> GetBoardState() const
+    {
+        std::vector<float> state(StateSize());
+        EncodeState(state.data());
+        return state;
+    }
     virtual std::unique_ptr<IGame> Clone() const = 0;
+    /// <summary>Turns this game into a full copy of the other one, undo history included, without allocating.
+    /// The other game has to be of the same type.</summary>
+    virtual void CopyFrom(const IGame& other) = 0;
     virtual bool InterpretAndMakeMove(const std::string& moveStr) = 0;
 
     inline virtual ~IGame() {}
-};
\ No newline at end of file
+};
+
+#endif // IGAME_INTERFACE_H
\ No newline at end of file
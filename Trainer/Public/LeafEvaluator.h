@@ -0,0 +1,72 @@
+#pragma once
+#include "IGame.h"
+#include "NeuralNetwork.h"
+#include "EvaluationCache.h"
+#include "GameOracle.h"
+#include <random>
+#include <vector>
+
+class SimulationEngine;
+
+struct PlayedMove
+{
+	int Player;
+	int Move;
+};
+
+/// <summary>Scores non-terminal MCTS leaves from the first player's perspective, in the range [-1, 1].</summary>
+class LeafEvaluator
+{
+public:
+	/// <summary>Evaluates the state. The state may be changed during evaluation but must be restored before returning.
+	/// Moves played on top of the state are appended to the trace when one is given.</summary>
+	virtual float Evaluate(IGame& state, std::mt19937& rng, std::vector<PlayedMove>* trace) const = 0;
+	inline virtual ~LeafEvaluator() {}
+};
+
+class NeuralLeafEvaluator : public LeafEvaluator
+{
+public:
+	/// <summary>Evaluations go through the cache when one is given.</summary>
+	NeuralLeafEvaluator(const NeuralNetwork* network, EvaluationCache* cache = nullptr);
+	float Evaluate(IGame& state, std::mt19937& rng, std::vector<PlayedMove>* trace) const;
+private:
+	const NeuralNetwork* m_network;
+	EvaluationCache* m_cache;
+};
+
+class RandomPlayoutEvaluator : public LeafEvaluator
+{
+public:
+	/// <summary>Averages the results of random games played from the leaf. Games longer than maxPlayoutMoves count as draws.
+	/// With an engine from the game module the playouts run there, otherwise through IGame; both consume the generator alike.</summary>
+	RandomPlayoutEvaluator(int playouts = 1, int maxPlayoutMoves = 400, const SimulationEngine* engine = nullptr);
+	float Evaluate(IGame& state, std::mt19937& rng, std::vector<PlayedMove>* trace) const;
+private:
+	int m_playouts;
+	int m_maxPlayoutMoves;
+	const SimulationEngine* m_engine;
+};
+
+class MixedLeafEvaluator : public LeafEvaluator
+{
+public:
+	/// <summary>Blends two evaluators as (1 - lambda) * value + lambda * playout.</summary>
+	MixedLeafEvaluator(const LeafEvaluator& valueEvaluator, const LeafEvaluator& playoutEvaluator, float lambda);
+	float Evaluate(IGame& state, std::mt19937& rng, std::vector<PlayedMove>* trace) const;
+private:
+	const LeafEvaluator& m_valueEvaluator;
+	const LeafEvaluator& m_playoutEvaluator;
+	float m_lambda;
+};
+
+class OracleLeafEvaluator : public LeafEvaluator
+{
+public:
+	/// <summary>Scores leaves the oracle reaches with their exact result and all others with the fallback evaluator.</summary>
+	OracleLeafEvaluator(const GameOracle& oracle, const LeafEvaluator& fallback);
+	float Evaluate(IGame& state, std::mt19937& rng, std::vector<PlayedMove>* trace) const;
+private:
+	const GameOracle& m_oracle;
+	const LeafEvaluator& m_fallback;
+};
\ No newline at end of file
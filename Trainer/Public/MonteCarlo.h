@@ -1,45 +1,80 @@
 #pragma once
-#include "Trainer.h"
+#include "IGame.h"
+#include "NeuralNetwork.h"
+#include "LeafEvaluator.h"
+#include "OpeningBook.h"
+#include "SearchTree.h"
+#include "SimulationEngine.h"
+#include <chrono>
+#include <cstdint>
 #include <mutex>
-
-struct treeNode 
-{
-	int Visits;
-	double TotalScore;
-	std::vector<treeNode*> Children;
-	treeNode* Parent;
-	int PreviousMove = -1;
-	std::mutex ExpansionMutex;
-	std::mutex ValueChangeMute;
-	std::mutex ChildrenMutex;
-	treeNode() : Visits(0), TotalScore(0.0), Parent(nullptr), Children() {}
-	~treeNode() 
-	{
-		for (auto& child : Children)
-		{
-			delete child;
-		}
-	}
-};
+#include <string>
 
 class MonteCarlo
 {
 public:
+	struct MemoryUsage
+	{
+		size_t PeakNodes = 0;
+		size_t PeakTreeBytes = 0;
+		size_t RecycledNodes = 0;
+		/// <summary>How far the resident memory of the process rose above its level when this search started. Only PeakTreeBytes counts the tree alone.</summary>
+		size_t ProcessGrowthBytes = 0;
+	};
+
+	struct RootMove
+	{
+		int Move;
+		int Visits;
+	};
+
 	struct EvaluationAndMove
 	{
 		int Move;
 		float stateEvaluation;
+		MemoryUsage Memory;
+		SearchStats Stats;
+		/// <summary>Visits of the root's moves, empty when the move came from the opening book.</summary>
+		std::vector<RootMove> RootMoves;
 	};
 
-	static int MonteCarloTreeSearch(IGame& initialState, float seconds, NeuralNetwork* ai);
-	static EvaluationAndMove MonteCarloTreeSearch(IGame& initialState, int iterations, NeuralNetwork* ai);
+	/// <summary>Approximate cost of a single node, including the parent's pointer to it.</summary>
+	static constexpr size_t NodeBytes = sizeof(treeNode) + sizeof(treeNode*);
+
+	static EvaluationAndMove MonteCarloTreeSearch(IGame& initialState, float seconds, NeuralNetwork* ai, const SearchSettings& settings = SearchSettings());
+	static EvaluationAndMove MonteCarloTreeSearch(IGame& initialState, float seconds, const LeafEvaluator& evaluator, const SearchSettings& settings = SearchSettings());
+	static EvaluationAndMove MonteCarloTreeSearch(IGame& initialState, int iterations, NeuralNetwork* ai, const SearchSettings& settings = SearchSettings());
+	static EvaluationAndMove MonteCarloTreeSearch(IGame& initialState, int iterations, const LeafEvaluator& evaluator, const SearchSettings& settings = SearchSettings());
 private:
+	struct SearchContext;
+
 	static int SelectBestAction(treeNode& root, IGame& initialState);
+	static EvaluationAndMove FinishSearch(SearchContext& context, IGame& initialState);
+	/// <summary>Answers the search from the opening book of the settings when it holds the position.</summary>
+	static bool ProbeBook(IGame& initialState, const SearchContext& context, EvaluationAndMove& result);
 
-	static void RunMCTSLoop(IGame* initialState, int iterations, treeNode* root, NeuralNetwork* ai, int rootPlayer);
-	static void RunMCTSLoop(IGame* initialState, std::chrono::high_resolution_clock::time_point startTime, 
-		std::chrono::duration<double> timeRestriction, treeNode* root, NeuralNetwork* ai, int rootPlayer);
-	static void PerformMCTSTurn(IGame& initialState, treeNode* rootNode, NeuralNetwork* ai, int rootPlayer);
-	static treeNode* SelectNodeUCB(treeNode* parent, bool isFirst);
-	static bool ExpandNode(IGame& board, treeNode* parent);
-};
\ No newline at end of file
+	static void RunMCTSLoop(IGame* initialState, int iterations, SearchContext& context, unsigned int threadIndex);
+	static void RunMCTSLoop(IGame* initialState, std::chrono::high_resolution_clock::time_point startTime,
+		std::chrono::duration<double> timeRestriction, SearchContext& context, unsigned int threadIndex);
+	/// <summary>Deterministic mode: leaves are selected one after another under virtual loss, evaluated in parallel
+	/// and backed up in selection order. Stops after the iteration count or the time limit, whichever comes first.</summary>
+	static void RunDeterministicSearch(IGame& initialState, SearchContext& context, int iterations, std::chrono::duration<double> timeRestriction);
+	/// <summary>Recycles subtrees when a thread asked for it, then runs one iteration in the engine under the shared tree lock.</summary>
+	static void PerformMCTSTurn(IGame& initialState, SearchContext& context, std::vector<PlayedMove>& path, std::mt19937& rng, SearchStats& stats);
+	/// <summary>Creates the root and expands it, so every thread starts from a grown tree.</summary>
+	static void CreateRoot(IGame& initialState, SearchContext& context);
+	/// <summary>Folds the counters of a finished thread into the search totals.</summary>
+	static void MergeThreadStats(SearchContext& context, const SearchStats& stats);
+	static void LogStats(const std::string& path, const EvaluationAndMove& result);
+	/// <summary>Collapses the least visited subtrees until the tree is back under its low-water mark. Needs exclusive access to the tree.</summary>
+	static void RecycleSubtrees(SearchContext& context);
+	/// <summary>Resident memory of the process now and its peak over the process lifetime.</summary>
+	struct ProcessMemory
+	{
+		size_t Resident = 0;
+		size_t PeakResident = 0;
+	};
+	static ProcessMemory GetProcessMemory();
+	/// <summary>Growth of the process over a search from the samples taken at its start and just before the tree is freed.</summary>
+	static size_t ProcessGrowth(const ProcessMemory& start, const ProcessMemory& end);
+};
@@ -1,4 +1,6 @@
 #pragma once
+#include <atomic>
+#include <cstdint>
 #include <sstream>
 #include <vector>
 
@@ -12,6 +14,13 @@ public:
     void SetKnownEvaluationBounds(float minEval, float maxEval);
     float GetClampedEvaluation(const std::vector<float>& input) const;
     float Evaluate(const std::vector<float>& input) const;
+    /// <summary>Evaluates InputSize() floats read straight from the pointer, e.g. a state written by IGame::EncodeState.</summary>
+    float GetClampedEvaluation(const float* input) const;
+    float Evaluate(const float* input) const;
+    int InputSize() const;
+    /// <summary>Changes whenever the weights change, so evaluations cached for an older version are never used.</summary>
+    uint64_t Version() const;
+    float ClampEvaluation(float rawEval) const;
     /// <summary>Completely random mutation.</summary>
     NeuralNetwork Mutate(int weightRate, int biasRate) const;
     void GradientDescent(const std::vector<float>& input, float target, float learningRate);
@@ -24,8 +33,13 @@ public:
     NeuralNetwork CloneWithNewId() const;
     void Save(std::string gameName) const;
     static NeuralNetwork Load(const std::string& filename);
+    /// <summary>Binary form of the network for checkpoints, Id and evaluation bounds included.</summary>
+    void WriteBinary(std::ostream& out) const;
+    static NeuralNetwork ReadBinary(std::istream& in);
 
 private:
+    static std::atomic<uint64_t> NextVersion;
+    uint64_t m_version;
     bool m_clampedEvaluationPossible = false;
     float m_minEvalKnown = -1.0f;
     float m_maxEvalKnown = 1.0f;
@@ -34,5 +48,5 @@ private:
     std::vector<std::vector<float>> m_biases;
 
     inline float Sigmoid(float x) const;
-    std::vector<float> FeedForward(const std::vector<float>& input) const;
+    float FeedForward(const float* input, int inputSize) const;
 };
\ No newline at end of file
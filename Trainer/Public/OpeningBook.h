@@ -0,0 +1,67 @@
+#pragma once
+#include "IGame.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// <summary>Opening moves collected from self-play: for every early position the moves the searches visited and the results
+/// of the games that played them, keyed by the position hash. Lets the search answer the first plies without searching.</summary>
+class OpeningBook
+{
+public:
+	/// <summary>One searched position of a self-play game.</summary>
+	struct LoggedPly
+	{
+		uint64_t Hash;
+		int Ply;
+		int Player;
+		int Move;
+		/// <summary>Root visits per move of the search, empty when the move did not come from a search.</summary>
+		std::vector<std::pair<int, int>> Visits;
+	};
+
+	struct Entry
+	{
+		uint64_t Hash;
+		int32_t Move;
+		/// <summary>Earliest ply the position was seen at.</summary>
+		uint16_t Ply;
+		uint16_t Reserved;
+		uint64_t Visits;
+		/// <summary>Games that played the move, and their average result for the player making it.</summary>
+		uint32_t Games;
+		float Score;
+	};
+
+	/// <summary>Appends the plies of a finished game as JSON lines, one per ply, with the result from the first player's perspective.
+	/// Safe to call from several threads.</summary>
+	static bool AppendGame(const std::string& logPath, const std::string& gameName, const std::vector<LoggedPly>& plies, IGame::Winner winner);
+	/// <summary>Adds up the visits and results of the game's plies before maxPly in the log and writes the book.
+	/// Positions seen in fewer than minGames games are left out. Returns the number of positions written, -1 on failure.</summary>
+	static long long Build(const std::string& logPath, const std::string& gameName, int maxPly, int minGames, const std::string& bookPath);
+
+	/// <summary>Maps the book file. On failure the book loaded before stays in use.</summary>
+	bool Load(const std::string& path);
+	bool IsLoaded() const;
+	/// <summary>Picks a legal book move for a position seen before maxPly, with probability proportional to its visits raised
+	/// to 1 / temperature; a temperature of 0 picks the most visited one. Value gets the move's average result from the
+	/// first player's perspective. Returns false when the position is not in the book. Safe to call from several threads.</summary>
+	bool Lookup(const IGame& game, int maxPly, double temperature, std::mt19937& rng, int& move, float& value) const;
+
+private:
+	struct FileHeader
+	{
+		char Magic[8];
+		uint32_t MaxPly;
+		uint32_t Reserved;
+		uint64_t Count;
+	};
+
+	MappedFile m_file;
+	/// <summary>Sorted by hash, then move.</summary>
+	const Entry* m_entries = nullptr;
+	uint64_t m_count = 0;
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/// <summary>Independent groups of random tasks. Each domain counts its tasks separately.</summary>
+enum class RandomDomain
+{
+	Network,
+	Mutation,
+	Fuzzing,
+	Training,
+	Matches,
+	Search,
+	Count,
+};
+
+/// <summary>Derives every random stream of the trainer from a single master seed.
+/// A task's seed depends only on the master seed, its domain and how many tasks of that domain came before it,
+/// and a generator only on its task seed and stream index, so runs with the same seed repeat exactly.</summary>
+class Random
+{
+public:
+	/// <summary>Sets the master seed and restarts the task counters of all domains.</summary>
+	static void SetMasterSeed(uint64_t seed);
+	static uint64_t GetMasterSeed();
+	/// <summary>Tasks started so far in every domain, in domain order. With the master seed they are all the state there is.</summary>
+	static std::vector<uint64_t> GetTaskCounters();
+	/// <summary>Continues the task sequences of a saved run, e.g. one restored from a checkpoint.</summary>
+	static void Restore(uint64_t masterSeed, const std::vector<uint64_t>& taskCounters);
+
+	/// <summary>Seed of the next task in the domain. Tasks have to be started in a fixed order for runs to repeat,
+	/// so parallel work should take one task seed up front and split it into streams.</summary>
+	static uint64_t NextTaskSeed(RandomDomain domain);
+	/// <summary>Generator for one stream of a task, e.g. one per thread or per work item.</summary>
+	static std::mt19937 MakeGenerator(uint64_t taskSeed, uint64_t stream = 0);
+
+	/// <summary>SplitMix64 finalizer, a bijective 64-bit mix.</summary>
+	static uint64_t Mix(uint64_t value);
+};
@@ -0,0 +1,330 @@
+#pragma once
+#include "IGame.h"
+#include "LeafEvaluator.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+class OpeningBook;
+class SimulationEngine;
+
+struct treeNode
+{
+	int Visits;
+	double TotalScore;
+	int AmafVisits;
+	double AmafScore;
+	std::vector<treeNode*> Children;
+	treeNode* Parent;
+	int PreviousMove = -1;
+	std::mutex ExpansionMutex;
+	std::mutex ValueChangeMute;
+	std::mutex ChildrenMutex;
+	treeNode() : Visits(0), TotalScore(0.0), AmafVisits(0), AmafScore(0.0), Parent(nullptr) {}
+	~treeNode()
+	{
+		for (auto& child : Children)
+		{
+			delete child;
+		}
+	}
+};
+
+enum class MemoryLimitPolicy
+{
+	/// <summary>Leaves stop being expanded and only their statistics keep improving.</summary>
+	StopExpanding,
+	/// <summary>Subtrees under the least visited nodes go back to the node pool and are regrown on demand.</summary>
+	RecycleSubtrees,
+};
+
+struct SearchSettings
+{
+	/// <summary>Blends all-moves-as-first statistics into selection (RAVE).</summary>
+	bool UseRave = false;
+	/// <summary>Visit count at which RAVE and UCT values are weighted equally.</summary>
+	double RaveEquivalence = 300.0;
+	/// <summary>Upper bound for the memory used by tree nodes, 0 for unlimited.</summary>
+	size_t MaxTreeBytes = 0;
+	MemoryLimitPolicy OnMemoryLimit = MemoryLimitPolicy::StopExpanding;
+	/// <summary>When set, the statistics of every search are appended to this file as one JSON object per line.</summary>
+	std::string StatsLogPath;
+	/// <summary>Seed of the search's random streams, 0 to take the next seed of the search domain.</summary>
+	uint64_t Seed = 0;
+	/// <summary>Searches in rounds with a fixed order, so the same seed and iteration count always give the same result.</summary>
+	bool Deterministic = false;
+	/// <summary>Leaves selected per deterministic round. Virtual losses keep them apart and they are evaluated in parallel.</summary>
+	int DeterministicBatchSize = 8;
+	/// <summary>Threads of a search, 0 for one per core.</summary>
+	unsigned int Threads = 0;
+	/// <summary>When set, positions the book holds from before BookMaxPly are answered with a book move instead of a search.</summary>
+	const OpeningBook* Book = nullptr;
+	int BookMaxPly = 8;
+	/// <summary>Book moves are sampled by visits raised to 1 / temperature; 0 always plays the most visited one.</summary>
+	double BookTemperature = 1.0;
+	/// <summary>Engine of the game module the tree is walked and grown in. Without one the search goes through IGame.</summary>
+	const SimulationEngine* Engine = nullptr;
+};
+
+struct SearchStats
+{
+	long long Iterations = 0;
+	long long NodesCreated = 0;
+	long long Expansions = 0;
+	int MaxDepth = 0;
+	long long TotalDepth = 0;
+	/// <summary>Calls into the leaf evaluator, network evaluations when searching with the neural evaluator.</summary>
+	long long LeafEvaluations = 0;
+	long long TerminalHits = 0;
+	double SelectionSeconds = 0.0;
+	double ExpansionSeconds = 0.0;
+	double EvaluationSeconds = 0.0;
+	double BackupSeconds = 0.0;
+	/// <summary>Lock acquisitions that found the lock taken, and the time spent waiting for them.</summary>
+	long long ContendedLocks = 0;
+	double LockWaitSeconds = 0.0;
+	double WallSeconds = 0.0;
+	int Threads = 0;
+	uint64_t Seed = 0;
+
+	/// <summary>Adds the counters of another thread. Wall time is not merged.</summary>
+	void Merge(const SearchStats& other);
+	double AverageDepth() const;
+	/// <summary>Average number of children created per expanded node.</summary>
+	double AverageBranching() const;
+	double IterationsPerSecond() const;
+	double NodesPerSecond() const;
+	std::string ToJson() const;
+};
+
+/// <summary>Locks the mutex, only timing the wait when another thread already holds it.</summary>
+template <typename Mutex>
+inline void LockCounted(Mutex& mutex, SearchStats& stats)
+{
+	if (mutex.try_lock())
+	{
+		return;
+	}
+	std::chrono::high_resolution_clock::time_point waitStart = std::chrono::high_resolution_clock::now();
+	mutex.lock();
+	stats.ContendedLocks++;
+	stats.LockWaitSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - waitStart).count();
+}
+
+/// <summary>Virtual loss a deterministic round put on a node, taken back when the leaf below it is backed up.</summary>
+struct VirtualLoss
+{
+	treeNode* Node;
+	float Score;
+};
+
+class NodePool
+{
+public:
+	~NodePool()
+	{
+		for (treeNode* node : m_free)
+		{
+			delete node;
+		}
+	}
+
+	void Acquire(size_t count, std::vector<treeNode*>& out)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (m_free.empty())
+			{
+				out.push_back(new treeNode());
+			}
+			else
+			{
+				out.push_back(m_free.back());
+				m_free.pop_back();
+			}
+		}
+	}
+
+	/// <summary>Returns the whole subtree below the node to the pool. Returns the number of released nodes.</summary>
+	size_t ReleaseChildren(treeNode* node)
+	{
+		size_t released = 0;
+		for (treeNode* child : node->Children)
+		{
+			released += ReleaseChildren(child) + 1;
+			child->Visits = 0;
+			child->TotalScore = 0.0;
+			child->AmafVisits = 0;
+			child->AmafScore = 0.0;
+			child->Parent = nullptr;
+			child->PreviousMove = -1;
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_free.push_back(child);
+		}
+		node->Children.clear();
+		return released;
+	}
+
+private:
+	std::mutex m_mutex;
+	std::vector<treeNode*> m_free;
+};
+
+/// <summary>The tree of one search and what its threads share while growing it. The search in the trainer owns it,
+/// the game-typed loops of a SimulationEngine walk and grow it.</summary>
+struct SearchTree
+{
+	SearchTree(const LeafEvaluator& evaluator, const SearchSettings& settings, size_t nodeBytes)
+		: Evaluator(evaluator), Settings(settings),
+		MaxNodes(settings.MaxTreeBytes / nodeBytes),
+		Recycling(settings.MaxTreeBytes > 0 && settings.OnMemoryLimit == MemoryLimitPolicy::RecycleSubtrees)
+	{
+	}
+
+	treeNode* Root = nullptr;
+	const LeafEvaluator& Evaluator;
+	const SearchSettings& Settings;
+	size_t MaxNodes;
+	bool Recycling;
+	NodePool Pool;
+	std::atomic<size_t> NodeCount{ 1 };
+	std::atomic<size_t> PeakNodeCount{ 1 };
+	std::atomic<size_t> RecycledNodes{ 0 };
+	std::atomic<bool> RecycleRequested{ false };
+	/// <summary>Held shared by every iteration and exclusively while subtrees are recycled.</summary>
+	std::shared_mutex TreeMutex;
+
+	static treeNode* SelectNodeUCB(treeNode* parent, bool isFirst, SearchStats& stats)
+	{
+		double explorationParameter = 1.41f;
+		treeNode* bestChild = nullptr;
+		bool allScoresZero = true;
+		double bestUCT = INT_MIN;
+
+		LockCounted(parent->ChildrenMutex, stats);
+		for (treeNode* child : parent->Children)
+		{
+			if (child->Visits == 0)
+			{
+				allScoresZero = false;
+				bestChild = child;
+				break;
+			}
+
+			double score = (isFirst ? child->TotalScore : -child->TotalScore);
+			double uct = score / child->Visits + explorationParameter * sqrt(log(parent->Visits) / child->Visits);
+
+			if (uct > bestUCT)
+			{
+				bestUCT = uct;
+				bestChild = child;
+			}
+		}
+		if (allScoresZero)
+		{
+			int minVisits = INT_MAX;
+			for (treeNode* child : parent->Children)
+			{
+				if (child->Visits < minVisits)
+				{
+					minVisits = child->Visits;
+					bestChild = child;
+				}
+			}
+		}
+		parent->ChildrenMutex.unlock();
+		return bestChild;
+	}
+
+	static treeNode* SelectNodeRave(treeNode* parent, bool isFirst, double raveEquivalence, SearchStats& stats)
+	{
+		double explorationParameter = 1.41f;
+		treeNode* bestChild = nullptr;
+		double bestValue = std::numeric_limits<double>::lowest();
+		double logParentVisits = log(std::max(parent->Visits, 1));
+
+		LockCounted(parent->ChildrenMutex, stats);
+		for (treeNode* child : parent->Children)
+		{
+			double uctValue = 0.0;
+			if (child->Visits > 0)
+			{
+				uctValue = (isFirst ? child->TotalScore : -child->TotalScore) / child->Visits;
+			}
+			double amafValue = 0.0;
+			if (child->AmafVisits > 0)
+			{
+				amafValue = (isFirst ? child->AmafScore : -child->AmafScore) / child->AmafVisits;
+			}
+
+			double beta = sqrt(raveEquivalence / (3.0 * child->Visits + raveEquivalence));
+			double value = (1.0 - beta) * uctValue + beta * amafValue
+				+ explorationParameter * sqrt(logParentVisits / (child->Visits + 1));
+
+			if (value > bestValue)
+			{
+				bestValue = value;
+				bestChild = child;
+			}
+		}
+		parent->ChildrenMutex.unlock();
+		return bestChild;
+	}
+
+	/// <summary>Credits every child of the path node at the given depth whose move the same player made later in the simulation.</summary>
+	static void UpdateAmaf(treeNode* node, const std::vector<PlayedMove>& path, size_t depth, float score, SearchStats& stats)
+	{
+		if (depth >= path.size())
+		{
+			return;
+		}
+
+		int player = path[depth].Player;
+		LockCounted(node->ChildrenMutex, stats);
+		for (treeNode* child : node->Children)
+		{
+			for (size_t i = depth; i < path.size(); ++i)
+			{
+				if (path[i].Player == player && path[i].Move == child->PreviousMove)
+				{
+					LockCounted(child->ValueChangeMute, stats);
+					child->AmafVisits++;
+					child->AmafScore += score;
+					child->ValueChangeMute.unlock();
+					break;
+				}
+			}
+		}
+		node->ChildrenMutex.unlock();
+	}
+
+	/// <summary>Hangs the moves below the node as new children. Called with the node's expansion and children locks held.</summary>
+	void AddChildren(treeNode* parent, const MoveList& moves, SearchStats& stats)
+	{
+		size_t moveCount = static_cast<size_t>(moves.Count);
+		Pool.Acquire(moveCount, parent->Children);
+		for (size_t i = 0; i < moveCount; ++i)
+		{
+			parent->Children[i]->PreviousMove = moves[static_cast<int>(i)];
+			parent->Children[i]->Parent = parent;
+		}
+
+		stats.Expansions++;
+		stats.NodesCreated += moveCount;
+		size_t nodeCount = NodeCount += moveCount;
+		size_t peak = PeakNodeCount;
+		while (nodeCount > peak && !PeakNodeCount.compare_exchange_weak(peak, nodeCount))
+		{
+			;
+		}
+	}
+};
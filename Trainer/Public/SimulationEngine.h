@@ -0,0 +1,380 @@
+#pragma once
+#include "IGame.h"
+#include "SearchTree.h"
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+/// <summary>Scores encoded states for the greedy match players. The trainer implements it, so game modules need no network code.</summary>
+class StateScorer
+{
+public:
+	/// <summary>Scores a state written by IGame::EncodeState.</summary>
+	virtual float Score(const float* state) const = 0;
+	inline virtual ~StateScorer() {}
+};
+
+/// <summary>The game loops the search and the matches spend their time in, compiled into a game module against the concrete game type.
+/// Calls inside them are direct and can be inlined, while IGame stays the interface for everything else.</summary>
+class SimulationEngine
+{
+public:
+	/// <summary>Expands the node the state is at, unless it already has children or the tree is out of memory.
+	/// Returns false only when another thread expanded it first.</summary>
+	virtual bool ExpandNode(IGame& state, treeNode* node, SearchTree& tree, SearchStats& stats) const = 0;
+	/// <summary>One MCTS iteration from the root: selection, expansion, leaf evaluation and backup. The state is back at the root afterwards.</summary>
+	virtual void SearchIteration(IGame& state, SearchTree& tree, std::vector<PlayedMove>& path, std::mt19937& rng, SearchStats& stats) const = 0;
+	/// <summary>Deterministic rounds: walks from the root to a leaf, putting a virtual loss on every node on the way, and expands it.
+	/// The state is left at the leaf and its result is returned.</summary>
+	virtual IGame::Winner SelectLeaf(IGame& state, SearchTree& tree, std::vector<PlayedMove>& path, std::vector<VirtualLoss>& losses, SearchStats& stats) const = 0;
+	/// <summary>Replaces the virtual losses of a leaf from SelectLeaf with its score and takes the state back to the root.</summary>
+	virtual void BackupLeaf(IGame& state, SearchTree& tree, const std::vector<PlayedMove>& path, const std::vector<VirtualLoss>& losses, float score, SearchStats& stats) const = 0;
+	/// <summary>Greedy one-ply choice by score. The scratch game is overwritten for every candidate move.</summary>
+	virtual int ChooseBestMove(const IGame& state, const StateScorer& scorer, IGame& scratch) const = 0;
+	/// <summary>Plays the game to its end with both sides choosing greedily, the first scorer for player 1.</summary>
+	virtual IGame::Winner PlayMatch(IGame& state, const StateScorer& first, const StateScorer& second, IGame& scratch) const = 0;
+	/// <summary>Averages the results of random games played from the state, from the first player's perspective.
+	/// Games longer than maxPlayoutMoves count as draws. The state is restored and the first playout's moves are appended to the trace.</summary>
+	virtual float RandomPlayouts(IGame& state, std::mt19937& rng, int playouts, int maxPlayoutMoves, std::vector<PlayedMove>* trace) const = 0;
+	/// <summary>Plays every move sequence of the given length with MakeMove/UnMakeMove and counts leaves and moves made.</summary>
+	virtual void Perft(IGame& state, int depth, long long& leafNodes, long long& movesMade) const = 0;
+	inline virtual ~SimulationEngine() {}
+
+	/// <summary>Engine running the same loops through IGame, for game modules that export none.</summary>
+	static const SimulationEngine& ThroughInterface();
+};
+
+/// <summary>SimulationEngine for one game type. The game has to be final, so calls through TGame are not virtual.
+/// States handed to it must be of that type. Instantiated with IGame itself, the loops go through the interface.</summary>
+template <typename TGame>
+class GameSimulationEngine final : public SimulationEngine
+{
+public:
+	float RandomPlayouts(IGame& state, std::mt19937& rng, int playouts, int maxPlayoutMoves, std::vector<PlayedMove>* trace) const
+	{
+		TGame& game = static_cast<TGame&>(state);
+		MoveList moves;
+		float total = 0.0f;
+		for (int playout = 0; playout < playouts; ++playout)
+		{
+			int movesMade = 0;
+			while (game.GetWinner() == IGame::Winner::OnGoing && movesMade < maxPlayoutMoves)
+			{
+				int moveCount = game.GenerateMoves(moves);
+				if (moveCount == 0)
+				{
+					break;
+				}
+
+				int player = game.GetCurrentPlayer();
+				int move = moves[std::uniform_int_distribution<int>(0, moveCount - 1)(rng)];
+				game.MakeMove(move);
+				++movesMade;
+
+				if (trace && playout == 0)
+				{
+					trace->push_back({ player, move });
+				}
+			}
+
+			if (game.GetWinner() == IGame::Winner::FirstPlayer)
+			{
+				total += 1.0f;
+			}
+			else if (game.GetWinner() == IGame::Winner::SecondPlayer)
+			{
+				total -= 1.0f;
+			}
+
+			for (int i = 0; i < movesMade; ++i)
+			{
+				game.UnMakeMove();
+			}
+		}
+		return total / playouts;
+	}
+
+	void Perft(IGame& state, int depth, long long& leafNodes, long long& movesMade) const
+	{
+		PerftRecursive(static_cast<TGame&>(state), depth, leafNodes, movesMade);
+	}
+
+	bool ExpandNode(IGame& state, treeNode* node, SearchTree& tree, SearchStats& stats) const
+	{
+		return Expand(static_cast<TGame&>(state), node, tree, stats);
+	}
+
+	void SearchIteration(IGame& state, SearchTree& tree, std::vector<PlayedMove>& path, std::mt19937& rng, SearchStats& stats) const
+	{
+		TGame& game = static_cast<TGame&>(state);
+		const SearchSettings& settings = tree.Settings;
+		std::chrono::high_resolution_clock::time_point phaseStart = std::chrono::high_resolution_clock::now();
+
+		path.clear();
+		int selectionDepth = 0;
+		treeNode* node = tree.Root;
+		while (!node->Children.empty())
+		{
+			int player = game.GetCurrentPlayer();
+			if (settings.UseRave)
+			{
+				node = SearchTree::SelectNodeRave(node, player == 1, settings.RaveEquivalence, stats);
+				path.push_back({ player, node->PreviousMove });
+			}
+			else
+			{
+				node = SearchTree::SelectNodeUCB(node, player == 1, stats);
+			}
+			++selectionDepth;
+			MakeTreeMove(game, node->PreviousMove);
+		}
+
+		std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+		stats.SelectionSeconds += std::chrono::duration<double>(now - phaseStart).count();
+		phaseStart = now;
+
+		bool expanded = Expand(game, node, tree, stats);
+		now = std::chrono::high_resolution_clock::now();
+		stats.ExpansionSeconds += std::chrono::duration<double>(now - phaseStart).count();
+		phaseStart = now;
+		if (!expanded)
+		{
+			while (node->Parent != nullptr)
+			{
+				node = node->Parent;
+				game.UnMakeMove();
+			}
+			return;
+		}
+
+		size_t depth = path.size();
+		float score = 0;
+		IGame::Winner winner = game.GetWinner();
+		if (winner != IGame::Winner::OnGoing)
+		{
+			stats.TerminalHits++;
+			score = winner == IGame::Winner::FirstPlayer ? 1.0f : winner == IGame::Winner::SecondPlayer ? -1.0f : 0.0f;
+		}
+		else
+		{
+			score = tree.Evaluator.Evaluate(game, rng, settings.UseRave ? &path : nullptr);
+			stats.LeafEvaluations++;
+		}
+		now = std::chrono::high_resolution_clock::now();
+		stats.EvaluationSeconds += std::chrono::duration<double>(now - phaseStart).count();
+		phaseStart = now;
+
+		while (node->Parent != nullptr)
+		{
+			LockCounted(node->ValueChangeMute, stats);
+			node->Visits++;
+			node->TotalScore += score;
+			node->ValueChangeMute.unlock();
+			if (settings.UseRave)
+			{
+				SearchTree::UpdateAmaf(node, path, depth, score, stats);
+			}
+			node = node->Parent;
+			--depth;
+			game.UnMakeMove();
+		}
+		LockCounted(node->ValueChangeMute, stats);
+		node->Visits++;
+		node->TotalScore += score;
+		node->ValueChangeMute.unlock();
+		if (settings.UseRave)
+		{
+			SearchTree::UpdateAmaf(node, path, depth, score, stats);
+		}
+
+		stats.BackupSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - phaseStart).count();
+		stats.Iterations++;
+		stats.TotalDepth += selectionDepth;
+		stats.MaxDepth = std::max(stats.MaxDepth, selectionDepth);
+	}
+
+	IGame::Winner SelectLeaf(IGame& state, SearchTree& tree, std::vector<PlayedMove>& path, std::vector<VirtualLoss>& losses, SearchStats& stats) const
+	{
+		TGame& game = static_cast<TGame&>(state);
+		const SearchSettings& settings = tree.Settings;
+		path.clear();
+		losses.clear();
+
+		treeNode* node = tree.Root;
+		while (!node->Children.empty())
+		{
+			int player = game.GetCurrentPlayer();
+			if (settings.UseRave)
+			{
+				node = SearchTree::SelectNodeRave(node, player == 1, settings.RaveEquivalence, stats);
+				path.push_back({ player, node->PreviousMove });
+			}
+			else
+			{
+				node = SearchTree::SelectNodeUCB(node, player == 1, stats);
+			}
+			MakeTreeMove(game, node->PreviousMove);
+			float virtualScore = player == 1 ? -1.0f : 1.0f;
+			node->Visits++;
+			node->TotalScore += virtualScore;
+			losses.push_back({ node, virtualScore });
+		}
+		std::chrono::high_resolution_clock::time_point expansionStart = std::chrono::high_resolution_clock::now();
+		Expand(game, node, tree, stats);
+		stats.ExpansionSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - expansionStart).count();
+
+		int depth = static_cast<int>(losses.size());
+		stats.TotalDepth += depth;
+		stats.MaxDepth = std::max(stats.MaxDepth, depth);
+		return game.GetWinner();
+	}
+
+	void BackupLeaf(IGame& state, SearchTree& tree, const std::vector<PlayedMove>& path, const std::vector<VirtualLoss>& losses, float score, SearchStats& stats) const
+	{
+		TGame& game = static_cast<TGame&>(state);
+		bool useRave = tree.Settings.UseRave;
+		size_t depth = losses.size();
+		for (auto loss = losses.rbegin(); loss != losses.rend(); ++loss)
+		{
+			loss->Node->TotalScore += score - loss->Score;
+			if (useRave)
+			{
+				SearchTree::UpdateAmaf(loss->Node, path, depth, score, stats);
+			}
+			--depth;
+			game.UnMakeMove();
+		}
+		tree.Root->Visits++;
+		tree.Root->TotalScore += score;
+		if (useRave)
+		{
+			SearchTree::UpdateAmaf(tree.Root, path, 0, score, stats);
+		}
+		stats.Iterations++;
+	}
+
+	int ChooseBestMove(const IGame& state, const StateScorer& scorer, IGame& scratch) const
+	{
+		return ChooseMove(static_cast<const TGame&>(state), scorer, static_cast<TGame&>(scratch));
+	}
+
+	IGame::Winner PlayMatch(IGame& state, const StateScorer& first, const StateScorer& second, IGame& scratch) const
+	{
+		TGame& game = static_cast<TGame&>(state);
+		TGame& board = static_cast<TGame&>(scratch);
+		while (game.GetWinner() == IGame::Winner::OnGoing)
+		{
+			const StateScorer& scorer = game.GetCurrentPlayer() == 1 ? first : second;
+			game.MakeMove(ChooseMove(game, scorer, board));
+		}
+		return game.GetWinner();
+	}
+
+private:
+	static void MakeTreeMove(TGame& game, int move)
+	{
+		if (!game.MakeMove(move))
+		{
+			std::cout << "Impossible move attempted!\n";
+			game.PrintBoard();
+			std::cout << "Attempted move: " << move << "\n";
+		}
+	}
+
+	static bool Expand(TGame& game, treeNode* parent, SearchTree& tree, SearchStats& stats)
+	{
+		LockCounted(parent->ExpansionMutex, stats);
+		LockCounted(parent->ChildrenMutex, stats);
+		if (!parent->Children.empty())
+		{
+			parent->ExpansionMutex.unlock();
+			parent->ChildrenMutex.unlock();
+			return false;
+		}
+		if (game.GetWinner() != IGame::Winner::OnGoing)
+		{
+			parent->ExpansionMutex.unlock();
+			parent->ChildrenMutex.unlock();
+			return true;
+		}
+
+		MoveList allMoves;
+		size_t moveCount = game.GenerateMoves(allMoves);
+		if (tree.MaxNodes > 0 && tree.NodeCount + moveCount > tree.MaxNodes && parent != tree.Root)
+		{
+			// Over budget: the node stays a leaf and keeps being evaluated.
+			if (tree.Recycling)
+			{
+				tree.RecycleRequested = true;
+			}
+			parent->ExpansionMutex.unlock();
+			parent->ChildrenMutex.unlock();
+			return true;
+		}
+
+		tree.AddChildren(parent, allMoves, stats);
+		parent->ExpansionMutex.unlock();
+		parent->ChildrenMutex.unlock();
+		return true;
+	}
+
+	static int ChooseMove(const TGame& game, const StateScorer& scorer, TGame& scratch)
+	{
+		MoveList validMoves;
+		game.GenerateMoves(validMoves);
+		int currentPlayer = game.GetCurrentPlayer();
+
+		float bestScore = currentPlayer == 1 ? std::numeric_limits<float>::max() : -std::numeric_limits<float>::max();
+		int bestMove = -1;
+		std::vector<float> state(game.StateSize());
+
+		for (int move : validMoves)
+		{
+			scratch.CopyFrom(game);
+			scratch.MakeMove(move);
+			scratch.EncodeState(state.data());
+			float score = scorer.Score(state.data());
+
+			if (currentPlayer != 1 ? score > bestScore : score < bestScore)
+			{
+				bestScore = score;
+				bestMove = move;
+			}
+		}
+
+		if (bestMove == -1 && validMoves.Count > 0)
+		{
+			game.PrintBoard();
+			std::cerr << "[WARNING] No best move found. Choosing fallback.\n";
+			bestMove = validMoves[0];
+		}
+		return bestMove;
+	}
+
+	static void PerftRecursive(TGame& game, int depth, long long& leafNodes, long long& movesMade)
+	{
+		if (depth == 0)
+		{
+			leafNodes++;
+			return;
+		}
+
+		MoveList moves;
+		game.GenerateMoves(moves);
+		for (int move : moves)
+		{
+			game.MakeMove(move);
+			movesMade++;
+			PerftRecursive(game, depth - 1, leafNodes, movesMade);
+			game.UnMakeMove();
+		}
+	}
+};
+
+inline const SimulationEngine& SimulationEngine::ThroughInterface()
+{
+	static const GameSimulationEngine<IGame> engine;
+	return engine;
+}
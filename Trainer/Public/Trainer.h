@@ -4,10 +4,22 @@
 #include <string>
 #include "NeuralNetwork.h"
 #include "IGame.h"
+#include "MonteCarlo.h"
+#include "SimulationEngine.h"
+#include "GameOracle.h"
+#include "EvaluationCache.h"
+#include "OpeningBook.h"
+#include "Checkpoint.h"
+#include <random>
+#include <chrono>
+#include <ostream>
+#include "TrainingConfig.h"
 
 class Trainer {
 public:
-    Trainer(std::unique_ptr<IGame> baseGame);
+    /// <summary>The engine, when the game module provides one, runs the random playouts of the search.
+    /// The oracle, when the module provides one, gives exact values for search leaves and training and serves as an opponent.</summary>
+    Trainer(std::unique_ptr<IGame> baseGame, std::unique_ptr<SimulationEngine> engine = nullptr, std::unique_ptr<GameOracle> oracle = nullptr);
 
     NeuralNetwork* GetChampion();
     /// <summary>
@@ -16,6 +28,9 @@ public:
     /// <param name="game">Pointer to the game instance for which to list saves.</param>
     static void ListSaves(IGame* game);
     void Run();
+    /// <summary>Trains as the config says without prompts and saves the champion, writing progress to stdout as JSON lines.
+    /// Returns the process exit code.</summary>
+    int RunHeadless(const TrainingConfig& config);
 
 private:
     struct Step {
@@ -33,11 +48,52 @@ private:
         int Losses = 0;
     };
 
+    enum class TrainingMode : uint8_t
+    {
+        None,
+        Evolution,
+        AgainstRandom,
+        PPO,
+    };
+
+    /// <summary>Where the training run in progress stands, so that a checkpoint can continue it from the next generation.</summary>
+    struct TrainingRun
+    {
+        TrainingMode Mode = TrainingMode::None;
+        int Generation = 0;
+        int Generations = 0;
+        /// <summary>The run's own generator, for the draws the training loop makes itself.</summary>
+        std::mt19937 Generator;
+    };
+
 
     int m_championImprovements = 0;
     
     float m_epsilon = 0.2f;
     int m_MCTSEpisodes = 100;
+    SearchSettings m_searchSettings;
+    float m_playoutLambda = 0.0f;
+    bool m_augmentSymmetries = false;
+    /// <summary>Score search leaves and PPO steps the oracle reaches with its exact results.</summary>
+    bool m_useOracle = false;
+    /// <summary>Shared by every search and fuzzing run of the trainer.</summary>
+    EvaluationCache m_evaluationCache;
+    /// <summary>Searches use it through m_searchSettings.Book while it is enabled.</summary>
+    OpeningBook m_openingBook;
+    std::string m_openingBookPath;
+    /// <summary>Opening plies of PPO self-play games are appended here for building opening books, when set.</summary>
+    std::string m_selfPlayLogPath;
+    int m_selfPlayLogPlies = 16;
+    TrainingRun m_run;
+    /// <summary>The whole training state is saved here in the background every m_checkpointInterval generations, when set.</summary>
+    std::string m_checkpointPath;
+    int m_checkpointInterval = 10;
+    Checkpoint m_checkpoint;
+    /// <summary>Threads for tournament matches, 0 for one per core. Searches take theirs from m_searchSettings.Threads.</summary>
+    int m_threads = 0;
+    /// <summary>JSON lines of a headless run's progress go here; null in the interactive menu, which polls the keyboard instead.</summary>
+    std::ostream* m_progress = nullptr;
+    std::chrono::steady_clock::time_point m_progressStart;
     int m_populationSize = 40;
     int m_matchesPerIteration = 4;
     float m_learningRate = 0.1f;
@@ -45,6 +101,8 @@ private:
     int m_championId = -1;
 
     std::unique_ptr<IGame> m_baseGame;
+    std::unique_ptr<SimulationEngine> m_simulationEngine;
+    std::unique_ptr<GameOracle> m_oracle;
     int m_mutationRate = 1;
 
     NeuralNetwork* m_loadedNetwork;
@@ -56,14 +114,35 @@ private:
     void ChangeParametersMenu();
     /// <summary>Trains the neural network against a random player for a number of generations using evolutionary algorithm.</summary>
     void TrainIterationsAgainstRandom(int generations);
-    /// <summary>Benchmarks current neural network against random moves.</summary>
-    void TestChampionAgainstRandom(int games);
+    /// <summary>Benchmarks current neural network against random moves, or against the oracle's moves where it reaches when one is given.</summary>
+    void TestChampion(int games, const GameOracle* opponent = nullptr);
     void TrainIterations(int n);
-    int ChooseBestMove(const IGame& game, const NeuralNetwork* network);
+    void StartRun(TrainingMode mode, int generations);
+    /// <summary>The training loops, running m_run from its current generation to its last.</summary>
+    void ContinueIterations();
+    void ContinueIterationsAgainstRandom();
+    void ContinueIterationsPPO();
+    /// <summary>Counts a finished generation and starts a checkpoint when one is due.</summary>
+    void FinishGeneration();
+    /// <summary>Population, hyperparameters, random state, run position and statistics in the binary checkpoint format.</summary>
+    std::string SerializeCheckpoint() const;
+    /// <summary>Replaces the training state with a checkpoint's. Leaves it untouched and returns false when the checkpoint
+    /// is damaged or belongs to another game.</summary>
+    bool RestoreCheckpoint(const std::string& bytes);
+    /// <summary>Restores the checkpoint and continues its training run, if it was cut short.</summary>
+    void ResumeTraining(const std::string& path);
+    void ContinueRun();
+    /// <summary>The game module's engine, or one running the same loops through IGame when the module exports none.</summary>
+    const SimulationEngine& Engine() const;
+    /// <summary>Greedy one-ply choice by network score, made in the engine. The scratch game is overwritten for every candidate move.</summary>
+    int ChooseBestMove(const IGame& game, const NeuralNetwork* network, IGame& scratch);
     void ApplyPPORewards(NeuralNetwork* nn, std::vector<Step>& history);
-    IGame::Winner PlayMatch(NeuralNetwork* nn1, NeuralNetwork* nn2);
+    /// <summary>Appends the position's symmetric copies when symmetric training is on, an empty list otherwise.</summary>
+    void RecordSymmetricSteps(const IGame& game, float valueEstimate, std::vector<std::vector<Step>>& symmetricSteps) const;
+    /// <summary>Plays a match in the given games, which are reset to the base game first, so threads can play matches side by side.</summary>
+    IGame::Winner PlayMatch(NeuralNetwork* nn1, NeuralNetwork* nn2, IGame& game, IGame& scratch);
     void TrainIterationsPPO(int generations);
     void EvaluateAndPromoteChampion();
-
-    std::unique_ptr<IGame> CloneGameWithMove(const IGame& game, int move);
+    /// <summary>Runs MCTS with leaves scored by the network, random playouts or a blend of both, depending on the playout weight.</summary>
+    MonteCarlo::EvaluationAndMove SearchMove(IGame& game, int iterations, NeuralNetwork* nn);
 };
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>Settings of a headless training run, read from a config file of key = value lines and from --key value
+/// arguments, which override the file. Keys are the field names in lower case with dashes, e.g. checkpoint-dir.</summary>
+struct TrainingConfig
+{
+	/// <summary>Name of the game as its module reports it, e.g. Connect Four.</summary>
+	std::string Game;
+	/// <summary>Directory of the game modules, empty for the executable's.</summary>
+	std::string Modules;
+	/// <summary>Hidden layer sizes, given as a comma separated list.</summary>
+	std::vector<int> Layers = { 42, 42, 21, 8 };
+	/// <summary>evolution, random or ppo: the menu's self-play tournament, training against random moves, or PPO.</summary>
+	std::string Algorithm = "evolution";
+	int Generations = 100;
+	/// <summary>Threads for tournaments and searches, 0 for one per core.</summary>
+	int Threads = 0;
+	/// <summary>Master seed of all random streams, 0 for a random one.</summary>
+	uint64_t Seed = 0;
+	int Population = 40;
+	int Matches = 4;
+	int MutationRate = 1;
+	float LearningRate = 0.1f;
+	float Epsilon = 0.2f;
+	int MctsEpisodes = 100;
+	/// <summary>Checkpoints go to this directory, named after the game, when it is set.</summary>
+	std::string CheckpointDir;
+	int CheckpointInterval = 10;
+	/// <summary>Continues the run saved in the checkpoint directory, if there is one, instead of starting a new one.</summary>
+	bool Resume = false;
+	/// <summary>Directory the champion network is saved to at the end.</summary>
+	std::string Output = ".";
+	/// <summary>Random games played to set the champion's evaluation bounds before it is saved, 0 to skip.</summary>
+	int FuzzGames = 0;
+
+	/// <summary>Reads --config file first, if given, then the other arguments. Returns false with a message on an
+	/// unknown key, a malformed value or a missing game.</summary>
+	static bool Parse(int argc, char** argv, int first, TrainingConfig& config, std::string& error);
+	/// <summary>Applies one setting. Returns false with a message when the key or value is not valid.</summary>
+	bool Set(const std::string& key, const std::string& value, std::string& error);
+	bool LoadFile(const std::string& path, std::string& error);
+	static const char* Usage();
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+
+/// <summary>SplitMix64 step, used to fill key tables.</summary>
+constexpr uint64_t NextZobristKey(uint64_t& state)
+{
+	uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+/// <summary>Zobrist keys of a game module, built at compile time from the seed so hashes are the same in every run.
+/// Keys are drawn in order: Kinds rows of Squares keys, e.g. one row per player or piece type, then the key for the
+/// second player to move, then Extras keys for whatever else the game hashes.</summary>
+template <int Kinds, int Squares, int Extras = 0>
+struct ZobristTable
+{
+	uint64_t Keys[Kinds][Squares] = {};
+	uint64_t SecondPlayerToMove = 0;
+	uint64_t Extra[Extras > 0 ? Extras : 1] = {};
+
+	constexpr explicit ZobristTable(uint64_t seed)
+	{
+		uint64_t state = seed;
+		for (int kind = 0; kind < Kinds; ++kind)
+		{
+			for (int square = 0; square < Squares; ++square)
+			{
+				Keys[kind][square] = NextZobristKey(state);
+			}
+		}
+		SecondPlayerToMove = NextZobristKey(state);
+		for (int i = 0; i < Extras; ++i)
+		{
+			Extra[i] = NextZobristKey(state);
+		}
+	}
+};